@@ -30,5 +30,5 @@ void BitWriter::writeBit(int value) {
 
 void BitWriter::write(std::string s) {
 	for (unsigned int i = 0; i < s.size(); i++)
-		writeBit(std::stoi(std::string(1, s[i])));
+		writeBit(s[i] == '1');
 }
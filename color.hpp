@@ -1,8 +1,28 @@
+#pragma once
+
 //! Enum for colors.
-enum class Color {
+enum class Color : unsigned char {
 	BLACK = 0, /*!< Enum value BLACK. */
 	BLUE, /*!< Enum value BLUE. */
 	GREEN, /*!< Enum value GREEN. */
 	RED, /*!< Enum value RED. */
-	WHITE /*!< Enum value WHITE. */
+	WHITE, /*!< Enum value WHITE. */
+	CYAN, /*!< Enum value CYAN. */
+	MAGENTA, /*!< Enum value MAGENTA. */
+	YELLOW /*!< Enum value YELLOW. */
 };
+
+//! Characters denoting the colors in .qd files, indexed by the Color enum.
+constexpr char colorChars[] = {'k', 'b', 'g', 'r', 'w', 'c', 'm', 'y'};
+
+//! BGR values of the colors, indexed by the Color enum.
+constexpr unsigned char colorValues[][3] = {{0, 0, 0}, {255, 0, 0}, {0, 255, 0}, {0, 0, 255}, {255, 255, 255}, {255, 255, 0}, {255, 0, 255}, {0, 255, 255}};
+
+//! Converts a character of a .qd file to Color enum.
+/*!
+	\param Character.
+	\return Color enum, WHITE for unknown characters.
+	*/
+constexpr Color char2Color(char c) {
+	return c == 'k' ? Color::BLACK : c == 'b' ? Color::BLUE : c == 'g' ? Color::GREEN : c == 'r' ? Color::RED : c == 'c' ? Color::CYAN : c == 'm' ? Color::MAGENTA : c == 'y' ? Color::YELLOW : Color::WHITE;
+}
@@ -1,6 +1,7 @@
 #include "quad.hpp"
 #include "huff.hpp"
 #include "proc.hpp"
+#include "stats.hpp"
 
 /*! \mainpage Algorithm outline
  * The compression algorithm can be broken down to the folllowing steps:
@@ -20,18 +21,57 @@
 int main(int argc, char** argv) {
 
 	if (argc < 2) {
-		printf("USAGE: wb [-d] FILENAME\n");
+		printf("USAGE: wb [-d] [-s STREAMS] [-m MODEL] [-p COLORS] [--target-size BYTES | --quality DB] [--floor THRESHOLD] [--stats] FILENAME\n");
 		return -1;
 	}
 
-	bool demo = false;
-
-	for (int i = 1; i < argc; i++)
-		if (argv[i][0] == '-')
+	bool demo = false, stats = false, floored = false;
+	int streams = 1, model = -1, palette = 0;
+	long budget = 0;
+	double quality = 0.0, floor = 16.0;
+
+	for (int i = 1; i < argc - 1; i++)
+		if (std::string(argv[i]) == "--stats")
+			stats = true;
+		else if (std::string(argv[i]) == "--target-size" && i + 1 < argc - 1)
+			budget = atol(argv[++i]);
+		else if (std::string(argv[i]) == "--quality" && i + 1 < argc - 1)
+			quality = atof(argv[++i]);
+		else if (std::string(argv[i]) == "--floor" && i + 1 < argc - 1) {
+			floor = atof(argv[++i]);
+			floored = true;
+		}
+		else if (argv[i][0] == '-') {
 			if (argv[i][1] == 'd')
 				demo = true;
+			else if (argv[i][1] == 's' && i + 1 < argc - 1)
+				streams = atoi(argv[++i]);
+			else if (argv[i][1] == 'm' && i + 1 < argc - 1)
+				model = atoi(argv[++i]);
+			else if (argv[i][1] == 'p' && i + 1 < argc - 1)
+				palette = atoi(argv[++i]);
+		}
+
+#ifndef WB_STATS
+	if (stats) {
+		fprintf(stderr, "wb: built without statistics, rebuild with make STATS=1\n");
+		return -1;
+	}
+#endif
 
-	cv::Mat image = cv::imread(argv[argc - 1]);
+	if (budget > 0 && quality > 0) {
+		fprintf(stderr, "wb: --target-size and --quality cannot be combined\n");
+		return -1;
+	}
+	if (floored && budget <= 0 && quality <= 0)
+		fprintf(stderr, "wb: --floor has no effect without --target-size or --quality\n");
+
+	cv::Mat image;
+	{
+		STATS_TIMER("imread");
+		image = cv::imread(argv[argc - 1]);
+	}
+	STATS_BYTES("bytes_in", argv[argc - 1]);
 
 	if (demo) {
 		demo_draw(image);
@@ -85,29 +125,49 @@ int main(int argc, char** argv) {
 		demo_draw(cropped);
 	}
 
-	image = crop(image);
-
-	double alpha = 1.0, beta = 20, gamma = 0.9;
-	for (int y = 0; y < image.rows; y++)
-		for (int x = 0; x < image.cols; x++)
-			for (int c = 0; c < image.channels(); c++)
-				image.at<cv::Vec3b>(y, x)[c] = cv::saturate_cast<uchar>(alpha * image.at<cv::Vec3b>(y, x)[c] + beta);
+	{
+		STATS_TIMER("crop");
+		image = crop(image);
+	}
 
-	cv::Mat lut(1, 256, CV_8U);
-	uchar* p = lut.ptr();
-	for (int i = 0; i < 256; i++)
-		p[i] = cv::saturate_cast<uchar>(pow(i / 255.0, gamma) * 255.0);
-	cv::LUT(image, lut, image);
+	{
+		STATS_TIMER("tonemap");
+		double alpha = 1.0, beta = 20, gamma = 0.9;
+		for (int y = 0; y < image.rows; y++)
+			for (int x = 0; x < image.cols; x++)
+				for (int c = 0; c < image.channels(); c++)
+					image.at<cv::Vec3b>(y, x)[c] = cv::saturate_cast<uchar>(alpha * image.at<cv::Vec3b>(y, x)[c] + beta);
 
-	QuadTree q(image);
+		cv::Mat lut(1, 256, CV_8U);
+		uchar* p = lut.ptr();
+		for (int i = 0; i < 256; i++)
+			p[i] = cv::saturate_cast<uchar>(pow(i / 255.0, gamma) * 255.0);
+		cv::LUT(image, lut, image);
+	}
+	STATS_COUNT("pixels", (long)image.rows * image.cols);
+
+	QuadTree q(image, budget > 0 || quality > 0 ? floor : QuadTree::diffThreshold);
+	q.setPalette(palette > 0 ? palette : q.detectPalette());
+	palette = q.getPalette();
+	STATS_COUNT("palette", palette);
+	if (budget > 0 && !q.fitSize([streams, model, palette](const std::map<char, long>& freq) {return codedSize(freq, streams, model, palette);}, budget))
+		fprintf(stderr, "wb: cannot fit into %ld bytes\n", budget);
+	else if (quality > 0 && !q.fitQuality(image, quality))
+		fprintf(stderr, "wb: cannot reach %.2f dB\n", quality);
+	STATS_COUNT("threshold", (long)q.getThreshold());
+	q.measure();
 	std::string filename = argv[argc - 1];
 	filename = filename.substr(0, filename.find_last_of("."));
 	q.print(filename);
-	huffman(filename);
+	STATS_BYTES("bytes_qd", filename + ".qd");
+	if (!huffman(filename, streams, model))
+		return -1;
+	STATS_BYTES("bytes_out", filename + ".wb");
+	STATS_BYTES("bytes_sym", filename + ".sym");
 
 	if (demo) {
 		dehuffman(filename);
-		QuadTree qq = QuadTree(filename);
+		QuadTree qq(filename);
 		cv::Mat comb = cv::Mat(image.rows, 2 * image.cols, CV_8UC3);
 		image.copyTo(comb(cv::Range(0, image.rows), cv::Range(0, image.cols)));
 		cv::Mat decomp = qq.getImage(true);
@@ -121,5 +181,10 @@ int main(int argc, char** argv) {
 		}
 	}
 
+#ifdef WB_STATS
+	if (stats)
+		Stats::json("wb", std::cout);
+#endif
+
 	return 0;
 }
@@ -1,23 +1,55 @@
 #include "quad.hpp"
 #include "huff.hpp"
 #include "proc.hpp"
+#include "stats.hpp"
 
 int main(int argc, char** argv) {
 
-	if (argc < 2) {
-		printf("USAGE: unwb FILENAME [OUT_FILENAME]\n");
+	bool stats = false;
+	int threads = 1;
+	std::vector<std::string> args;
+
+	for (int i = 1; i < argc; i++)
+		if (std::string(argv[i]) == "--stats")
+			stats = true;
+		else if (std::string(argv[i]) == "-j" && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else
+			args.push_back(argv[i]);
+
+	if (args.size() < 1) {
+		printf("USAGE: unwb [-j THREADS] [--stats] FILENAME [OUT_FILENAME]\n");
+		return -1;
+	}
+
+#ifndef WB_STATS
+	if (stats) {
+		fprintf(stderr, "unwb: built without statistics, rebuild with make STATS=1\n");
 		return -1;
 	}
+#endif
 
-	std::string filename = argv[1];
+	std::string filename = args[0];
 	filename = filename.substr(0, filename.find_last_of("."));
-	dehuffman(filename);
-	QuadTree q(filename);
-	cv::Mat decomp = q.getImage(false);
-	if (argc == 3)
-		cv::imwrite(argv[2], decomp);
-	else
-		cv::imwrite(std::string(filename) + "_comp.jpg", decomp);
+	STATS_BYTES("bytes_in", filename + ".wb");
+	STATS_BYTES("bytes_sym", filename + ".sym");
+	if (!dehuffman(filename, threads))
+		return -1;
+	STATS_BYTES("bytes_qd", filename + ".qd");
+	QuadTree q(filename, threads);
+	q.measure();
+	cv::Mat decomp = q.getImage(false, threads);
+	std::string out = args.size() == 2 ? args[1] : filename + "_comp.jpg";
+	{
+		STATS_TIMER("imwrite");
+		cv::imwrite(out, decomp);
+	}
+	STATS_BYTES("bytes_out", out);
+
+#ifdef WB_STATS
+	if (stats)
+		Stats::json("unwb", std::cout);
+#endif
 
 	return 0;
 }
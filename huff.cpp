@@ -4,100 +4,482 @@
 #include <utility>
 #include <algorithm>
 #include <numeric>
+#include <queue>
+#include <thread>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include "huff.hpp"
 #include "bitwriter.hpp"
-#include "bitreader.hpp"
+#include "models.hpp"
+#include "stats.hpp"
 
-void huffman(std::string filename) {
-	std::map<char, int> freq;
-	std::ifstream file(filename + ".qd");
-	char tmp;
-	int x, y;
-	file >> x >> y;
-	while (file >> tmp) {
-		if (freq.find(tmp) == freq.end())
-			freq[tmp] = 0;
-		freq[tmp]++;
+//! Entry of a decoding table.
+struct DecodeEntry {
+	char symbol; /*!< Decoded character. */
+	unsigned char length; /*!< Length of its code, zero for unused entries. */
+};
+
+//! Lookup table of a prefix code.
+/*!
+	The table is indexed by the next bits of the stream and holds the character whose code is a prefix of them.
+	*/
+struct DecodeTable {
+	std::vector<DecodeEntry> entries; /*!< Entries of the table. */
+	int bits; /*!< Number of bits used as index. */
+};
+
+//! Number of decoded symbols above which the streams are split among threads.
+static const size_t parallelSymbols = 1 << 20;
+
+//! Builds the decoding table of a prefix code.
+/*!
+	\param Character-symbol mapping.
+	\return Decoding table.
+	*/
+static DecodeTable buildTable(const std::map<char, std::string>& sym) {
+	DecodeTable table;
+	table.bits = 1;
+	for (auto it = sym.begin(); it != sym.end(); it++)
+		table.bits = std::max(table.bits, (int)it->second.size());
+	table.entries.assign(1 << table.bits, DecodeEntry{0, 0});
+	for (auto it = sym.begin(); it != sym.end(); it++) {
+		if (it->second.empty())
+			continue;
+		int value = std::accumulate(it->second.begin(), it->second.end(), 0, [](int v, char c){return v << 1 | (c == '1');});
+		int shift = table.bits - it->second.size();
+		std::fill(table.entries.begin() + (value << shift), table.entries.begin() + ((value + 1) << shift), DecodeEntry{it->first, (unsigned char)it->second.size()});
 	}
+	return table;
+}
 
-	std::vector<std::pair<std::string, int>> tree;
+//! Returns the next 64 bits of a buffer starting on the given bit.
+/*!
+	Bits past the end of the buffer are zero.
+	\param Buffer.
+	\param Size of buffer.
+	\param Index of bit.
+	\return Bits aligned to the most significant bit.
+	*/
+static inline uint64_t peek(const unsigned char* data, size_t size, size_t bit) {
+	size_t byte = bit >> 3;
+	uint64_t w = 0;
+	if (byte + 8 <= size) {
+		memcpy(&w, data + byte, 8);
+		w = __builtin_bswap64(w);
+	} else
+		for (int i = 0; i < 8; i++)
+			w = w << 8 | (byte + i < size ? data[byte + i] : 0);
+	return w << (bit & 7);
+}
+
+//! Decodes a group of streams in one loop.
+/*!
+	The streams do not depend on each other, so the lookups of one iteration can run in parallel.
+	\param Decoding table.
+	\param Buffer.
+	\param Size of buffer.
+	\param Starting bit of each stream.
+	\param Number of symbols in each stream.
+	\param Output of each stream.
+	*/
+template<int W>
+static void decodeGroup(const DecodeTable& table, const unsigned char* data, size_t size, const size_t* start, const size_t* count, char* const* out) {
+	size_t pos[W];
+	size_t n = count[0];
+	for (int s = 0; s < W; s++) {
+		pos[s] = start[s];
+		n = std::min(n, count[s]);
+	}
+	const int shift = 64 - table.bits;
+	for (size_t j = 0; j < n; j++)
+		for (int s = 0; s < W; s++) {
+			const DecodeEntry& e = table.entries[peek(data, size, pos[s]) >> shift];
+			out[s][j] = e.symbol;
+			pos[s] += e.length;
+		}
+	for (int s = 0; s < W; s++)
+		for (size_t j = n; j < count[s]; j++) {
+			const DecodeEntry& e = table.entries[peek(data, size, pos[s]) >> shift];
+			out[s][j] = e.symbol;
+			pos[s] += e.length;
+		}
+}
+
+//! Converts an integer to binary string.
+/*!
+	\param Value.
+	\param Number of bits.
+	\return String containing the bits from the most significant one.
+	*/
+static std::string binary(unsigned long value, int bits) {
+	std::string s = "";
+	std::generate_n(std::back_insert_iterator<std::string>(s), bits, [value, bits, i = 0]() mutable {return (value >> (bits - 1 - i++)) & 1 ? '1' : '0';});
+	return s;
+}
+
+//! Reads an integer from a buffer.
+/*!
+	\param Buffer.
+	\param Size of buffer.
+	\param Index of first bit.
+	\param Number of bits.
+	\return Value.
+	*/
+static unsigned long unbinary(const unsigned char* data, size_t size, size_t bit, int bits) {
+	return peek(data, size, bit) >> (64 - bits);
+}
+
+//! Returns the mapping of a static model.
+/*!
+	\param Model ID.
+	\return Map from characters to the binary strings of their codes, empty if there is no such model.
+	*/
+static std::map<char, std::string> modelSymbols(int id) {
 	std::map<char, std::string> sym;
+	for (int i = 0; i < modelCount; i++)
+		if (models[i].id == id)
+			for (int j = 0; j < models[i].size; j++)
+				sym[models[i].codes[j].symbol] = binary(models[i].codes[j].code, models[i].codes[j].length);
+	return sym;
+}
+
+std::map<char, std::string> buildCode(const std::map<char, long>& freq) {
+	std::map<char, std::string> sym;
+	if (freq.empty())
+		return sym;
+
+	std::priority_queue<std::pair<long, int>, std::vector<std::pair<long, int>>, std::greater<std::pair<long, int>>> queue;
+	std::vector<int> parent(2 * freq.size() - 1, -1);
+	int nodes = 0;
+	for (auto it = freq.begin(); it != freq.end(); it++)
+		queue.push(std::make_pair(it->second, nodes++));
+	while (queue.size() > 1) {
+		std::pair<long, int> a = queue.top();
+		queue.pop();
+		std::pair<long, int> b = queue.top();
+		queue.pop();
+		parent[a.second] = parent[b.second] = nodes;
+		queue.push(std::make_pair(a.first + b.first, nodes++));
+	}
+
+	std::vector<std::pair<int, char>> lengths;
+	int leaf = 0;
+	for (auto it = freq.begin(); it != freq.end(); it++, leaf++) {
+		int length = 0;
+		for (int node = leaf; parent[node] != -1; node = parent[node])
+			length++;
+		lengths.push_back(std::make_pair(std::max(length, 1), it->first));
+	}
+	std::sort(lengths.begin(), lengths.end());
+	unsigned long code = 0;
+	for (unsigned int i = 0; i < lengths.size(); i++) {
+		if (i > 0)
+			code = (code + 1) << (lengths[i].first - lengths[i - 1].first);
+		sym[lengths[i].second] = binary(code, lengths[i].first);
+	}
+	return sym;
+}
+
+//! Number of bits of the coded symbols.
+/*!
+	\param Frequency of each character.
+	\param Character-symbol mapping.
+	\return Number of bits, -1 if a character has no code.
+	*/
+static long payloadBits(const std::map<char, long>& freq, const std::map<char, std::string>& sym) {
+	long bits = 0;
 	for (auto it = freq.begin(); it != freq.end(); it++) {
-		sym[it->first] = "";
-		tree.push_back(std::make_pair(std::string(1, it->first), it->second));
+		auto code = sym.find(it->first);
+		if (code == sym.end())
+			return -1;
+		bits += it->second * code->second.size();
 	}
+	return bits;
+}
 
-	while (tree.size() > 1) {
-		std::sort(tree.begin(), tree.end(), [](std::pair<std::string, int> a, std::pair<std::string, int> b) {return a.second > b.second;});
-		for (unsigned int i = 0; i < tree[tree.size() - 1].first.size(); i++)
-			sym[tree[tree.size() - 1].first[i]] = "0" + sym[tree[tree.size() - 1].first[i]];
-		for (unsigned int i = 0; i < tree[tree.size() - 2].first.size(); i++)
-			sym[tree[tree.size() - 2].first[i]] = "1" + sym[tree[tree.size() - 2].first[i]];
-		tree[tree.size() - 2].first += tree[tree.size() - 1].first;
-		tree[tree.size() - 2].second += tree[tree.size() - 1].second;
-		tree.pop_back();
+//! Number of bits of a packed bilevel tree.
+/*!
+	\param Frequency of each character.
+	\return One bit for each node and one for each leaf, -1 if a character is not a split, a black or a white leaf.
+	*/
+static long packedBits(const std::map<char, long>& freq) {
+	long bits = 0;
+	for (auto it = freq.begin(); it != freq.end(); it++) {
+		if (it->first != '|' && it->first != 'k' && it->first != 'w')
+			return -1;
+		bits += it->second * (it->first == '|' ? 1 : 2);
 	}
-	file.close();
+	return bits;
+}
+
+//! Decodes a packed bilevel tree.
+/*!
+	Reads the structure bits of the nodes in the order they are printed until the tree is complete, then the color bits of its leaves.
+	\param Buffer.
+	\param Size of buffer.
+	\param Index of the first bit of the tree.
+	\param Index of the bit after the tree.
+	\return String containing the symbols.
+	*/
+static std::string unpack(const unsigned char* data, size_t size, size_t pos, size_t end) {
+	std::string result;
+	for (long open = 1; open > 0 && pos < end; ) {
+		uint64_t w = peek(data, size, pos);
+		for (int n = std::min<size_t>(64 - (pos & 7), end - pos); n > 0 && open > 0; n--, pos++, w <<= 1) {
+			bool split = w >> 63;
+			result.push_back(split ? '|' : 'w');
+			open += split ? 3 : -1;
+		}
+	}
+	for (size_t i = 0; i < result.size() && pos < end; i++)
+		if (result[i] != '|' && peek(data, size, pos++) >> 63)
+			result[i] = 'k';
+	return result;
+}
 
-	int badbits = (13 - std::accumulate(sym.begin(), sym.end(), 0, [&freq](int sum, const std::map<char, std::string>::value_type& p){return sum + freq[p.first] * p.second.size();})) % 8;
-	auto nth_badbit = [&badbits](int i) -> std::string {return (badbits >> 7 - (i & 7)) & 1 ? "1" : "0";};
-	auto nth_sizebit = [](int size, int i) -> char {return (size >> 15 - (i & 15)) & 1 ? '1' : '0';};
+//! Chooses the code of a file.
+/*!
+	Compares the static models, the Huffman code built for the file, whose .sym table is counted too, and for bilevel files with one stream the packed tree, which needs no table.
+	\param Frequency of each character.
+	\param Number of streams.
+	\param Model ID, or -1 to choose automatically.
+	\param Number of colors of the palette.
+	\param Character-symbol mapping (output).
+	\param Model ID (output).
+	\param Boolean about packing the tree (output).
+	\return Size of the .wb file and the .sym table in bits, with the padding of the streams counted as full bytes.
+	*/
+static long chooseCode(const std::map<char, long>& freq, int streams, int model, int palette, std::map<char, std::string>& sym, int& id, bool& packed) {
+	auto header = [streams, palette](int id) -> long {return streams == 1 && id == 0 ? (palette == 5 ? 35 : 43) : 88 + 32 * streams;};
+	long best = 0;
+	sym.clear();
+	id = 0;
+	packed = false;
+	if (model != 0) {
+		for (int i = 0; i < modelCount; i++) {
+			if (model > 0 && models[i].id != model)
+				continue;
+			std::map<char, std::string> s = modelSymbols(models[i].id);
+			long bits = payloadBits(freq, s);
+			if (bits >= 0 && (sym.empty() || bits + header(models[i].id) < best)) {
+				sym = s;
+				id = models[i].id;
+				best = bits + header(id);
+			}
+		}
+	}
+	if (model <= 0 || sym.empty()) {
+		std::map<char, std::string> s = buildCode(freq);
+		long table = std::accumulate(s.begin(), s.end(), 0L, [](long sum, const std::map<char, std::string>::value_type& p){return sum + 8 * (p.second.size() + 3);});
+		long bits = payloadBits(freq, s) + table + header(0);
+		if (sym.empty() || bits < best) {
+			sym = s;
+			id = 0;
+			best = bits;
+		}
+	}
+	long bits = packedBits(freq);
+	if (model < 0 && streams == 1 && palette == 2 && bits >= 0 && bits + header(0) <= best) {
+		sym.clear();
+		id = 0;
+		packed = true;
+		best = bits + header(0);
+	}
+	return best + 7 * (streams - 1);
+}
 
-	std::string sx = "", sy = "";
-	std::generate_n(std::back_insert_iterator<std::string>(sx), 16, [x, nth_sizebit, i = 0]() mutable {return nth_sizebit(x, i++);});
-	std::generate_n(std::back_insert_iterator<std::string>(sy), 16, [y, nth_sizebit, i = 0]() mutable {return nth_sizebit(y, i++);});
+long codedSize(const std::map<char, long>& freq, int streams, int model, int palette) {
+	std::map<char, std::string> sym;
+	int id;
+	bool packed;
+	return (chooseCode(freq, std::max(1, std::min(streams, 255)), model, palette, sym, id, packed) + 7) / 8;
+}
 
-	file.open(filename + ".qd");
-	BitWriter out(filename + ".wb");
-	int tmpi;
-	file >> tmpi >> tmpi;
-	out.write(sx);
-	out.write(sy);
-	out.write(nth_badbit(5) + nth_badbit(6) + nth_badbit(7));
-	while (file >> tmp)
-		out.write(sym[tmp]);
+bool huffman(std::string filename, int streams, int model) {
+	STATS_TIMER("huffman");
+	std::map<char, long> freq;
+	std::ifstream file(filename + ".qd");
+	std::string data;
+	char tmp;
+	int x, y, palette = 5;
+	file >> x >> y >> std::ws;
+	if (std::isdigit(file.peek()))
+		file >> palette;
+	while (file >> tmp) {
+		freq[tmp]++;
+		data.push_back(tmp);
+	}
 	file.close();
+	if (x > 0x7fff || y > 0x7fff) {
+		fprintf(stderr, "huffman: %s.qd is %dx%d, .wb files hold at most 32767 pixels on each side\n", filename.c_str(), x, y);
+		return false;
+	}
+	for (auto it = freq.begin(); it != freq.end(); it++)
+		STATS_SYMBOL(it->first, it->second);
+
+	streams = std::max(1, std::min(streams, 255));
+	std::map<char, std::string> sym;
+	int id = 0;
+	bool packed = false;
+	chooseCode(freq, streams, model, palette, sym, id, packed);
+	if (model > 0 && modelSymbols(model).empty())
+		fprintf(stderr, "huffman: unknown model %d, using model %d\n", model, id);
+	else if (model > 0 && id != model)
+		fprintf(stderr, "huffman: model %d cannot code %s.qd, using model %d\n", model, filename.c_str(), id);
+	STATS_COUNT("model", id);
+	STATS_COUNT("packed", packed);
 
+	BitWriter out(filename + ".wb");
+	if (streams == 1 && id == 0) {
+		bool compact = packed || palette != 5;
+		int badbits = (8 - ((compact ? 43 : 35) + (packed ? packedBits(freq) : payloadBits(freq, sym))) % 8) % 8;
+		out.write(binary(x, 16));
+		out.write(binary(compact ? y | 0x8000 : y, 16));
+		if (compact)
+			out.write(binary(palette | (packed ? 0x80 : 0), 8));
+		out.write(binary(badbits, 3));
+		if (packed) {
+			for (unsigned int i = 0; i < data.size(); i++)
+				out.write(data[i] == '|' ? "1" : "0");
+			for (unsigned int i = 0; i < data.size(); i++)
+				if (data[i] != '|')
+					out.write(data[i] == 'k' ? "1" : "0");
+		} else
+			for (unsigned int i = 0; i < data.size(); i++)
+				out.write(sym[data[i]]);
+	} else {
+		size_t chunk = (data.size() + streams - 1) / streams;
+		std::vector<unsigned long> lengths(streams, 0);
+		for (unsigned int i = 0; i < data.size(); i++)
+			lengths[i / chunk] += sym[data[i]].size();
+		out.write(binary(x | 0x8000, 16));
+		out.write(binary(y, 16));
+		out.write(binary(streams, 8));
+		out.write(binary(id, 8));
+		out.write(binary(palette, 8));
+		out.write(binary(data.size(), 32));
+		for (int s = 0; s < streams; s++)
+			out.write(binary(lengths[s], 32));
+		for (int s = 0; s < streams; s++) {
+			for (size_t i = s * chunk; i < std::min(data.size(), (s + 1) * chunk); i++)
+				out.write(sym[data[i]]);
+			out.write(std::string((8 - lengths[s] % 8) % 8, '0'));
+		}
+	}
+
+	if (id != 0 || packed) {
+		remove((filename + ".sym").c_str());
+		return true;
+	}
 	std::ofstream symfile(filename + ".sym");
 	for (auto it = sym.begin(); it != sym.end(); it++)
 		symfile << it->first << " " << it->second << "\n";
 	symfile.close();
+	return true;
 }
 
-void dehuffman(std::string filename) {
-	std::map<std::string, char> sym;
+std::map<char, std::string> readSymbols(std::string filename) {
+	std::map<char, std::string> sym;
 	std::ifstream symfile(filename + ".sym");
 	char tmpc;
 	std::string tmps;
-	while (symfile >> tmpc >> tmps) 
-		sym[tmps] = tmpc;
+	while (symfile >> tmpc >> tmps)
+		sym[tmpc] = tmps;
 	symfile.close();
+	return sym;
+}
 
-	auto get_bit = [](bool b, int i, int size){return ((int)b & 0x1) << (size - 1) - (i & (size - 1));};
+std::string decode(const std::vector<unsigned char>& buffer, const std::map<char, std::string>& sym, int& x, int& y, int& palette, int threads) {
+	const unsigned char* data = buffer.data();
+	size_t size = buffer.size();
+	std::string result;
+	if (size < 4)
+		return result;
+	x = unbinary(data, size, 0, 16);
+	y = unbinary(data, size, 16, 16);
+	palette = 5;
 
-	BitReader in(filename + ".wb");
-	std::ofstream file(filename + ".qd");
-	std::vector<bool> bits = in.read();	
-	int x = 0, y = 0, badbits = 0;
-	for (int i = 0; i < 16; i++)
-		x |= get_bit(bits[i], i, 16);		
-	for (int i = 0; i < 16; i++)
-		y |= get_bit(bits[16 + i], i, 16);
-	for (int i = 0; i < 3; i++)
-		badbits |= get_bit(bits[32 + i], 5 + i, 8);
-	bits.erase(bits.begin(), bits.end()+35);
-	file << x << " " << y;
-	tmps = "";
-	while (bits.size() != 0) {
-		for (int i = 0; i < bits.size(); i++) {
-			if (i == bits.size() - badbits && !in.ready())
+	if (!(x & 0x8000)) {
+		size_t pos = 35;
+		bool packed = false;
+		if (y & 0x8000) {
+			y &= 0x7fff;
+			palette = unbinary(data, size, 32, 8);
+			packed = palette & 0x80;
+			palette &= 0x7f;
+			pos = 43;
+		}
+		size_t end = size * 8 - unbinary(data, size, pos - 3, 3);
+		if (packed)
+			return unpack(data, size, pos, end);
+		DecodeTable table = buildTable(sym);
+		const int shift = 64 - table.bits;
+		while (pos < end) {
+			const DecodeEntry& e = table.entries[peek(data, size, pos) >> shift];
+			if (e.length == 0 || pos + e.length > end)
 				break;
-			tmps.push_back(bits[i] ? '1' : '0');
-			if (sym.find(tmps) != sym.end()) {
-				file << sym[tmps];
-				tmps = "";
-			}
+			result.push_back(e.symbol);
+			pos += e.length;
 		}
-		bits = in.read();
+		return result;
+	}
+
+	x &= 0x7fff;
+	int streams = unbinary(data, size, 32, 8);
+	int id = unbinary(data, size, 40, 8);
+	palette = unbinary(data, size, 48, 8);
+	std::map<char, std::string> code = id == 0 ? sym : modelSymbols(id);
+	if (code.empty())
+		return result;
+	DecodeTable table = buildTable(code);
+	size_t total = unbinary(data, size, 56, 32);
+	size_t chunk = streams ? (total + streams - 1) / streams : 0;
+	std::vector<size_t> start(streams), count(streams);
+	std::vector<char*> out(streams);
+	size_t bit = 88 + 32 * streams;
+	result.resize(total);
+	for (int s = 0; s < streams; s++) {
+		start[s] = bit;
+		bit += (unbinary(data, size, 88 + 32 * s, 32) + 7) / 8 * 8;
+		count[s] = s * chunk < total ? std::min(chunk, total - s * chunk) : 0;
+		out[s] = &result[0] + std::min(total, s * chunk);
+	}
+
+	auto work = [&](int first, int last) {
+		int s = first;
+		for (; s + 4 <= last; s += 4)
+			decodeGroup<4>(table, data, size, &start[s], &count[s], &out[s]);
+		for (; s < last; s++)
+			decodeGroup<1>(table, data, size, &start[s], &count[s], &out[s]);
+	};
+	threads = std::max(1, std::min(threads, streams));
+	if (threads == 1 || total < parallelSymbols) {
+		work(0, streams);
+		return result;
 	}
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; t++)
+		workers.push_back(std::thread(work, streams * t / threads, streams * (t + 1) / threads));
+	for (unsigned int t = 0; t < workers.size(); t++)
+		workers[t].join();
+	return result;
+}
+
+bool dehuffman(std::string filename, int threads) {
+	STATS_TIMER("dehuffman");
+	std::ifstream in(filename + ".wb", std::ios::binary);
+	std::vector<unsigned char> buffer((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	in.close();
+	int x = 0, y = 0, palette = 5;
+	std::string data = decode(buffer, readSymbols(filename), x, y, palette, threads);
+	if (data.empty()) {
+		fprintf(stderr, "dehuffman: cannot decode %s.wb\n", filename.c_str());
+		return false;
+	}
+	std::ofstream file(filename + ".qd");
+	file << x << " " << y << " " << palette << data;
 	file.close();
+	return true;
 }
@@ -1,11 +1,63 @@
+#include <map>
+#include <string>
+#include <vector>
+
 //! Huffman codes given file.
 /*!
 	Codes well-formatted .qd files into binary .wb file. The .wb file (stands for whiteboard) contains the width and height of the image on the first four bytes (two and two, respectively) and the number of bad bits on the next three bits, then the data. The function also prints the character-symbol mapping into a .sym file.
+
+	With a palette other than the standard five colors the highest bit of the height is set and the number of colors follows on one byte before the bad bits. The highest bit of this byte marks a packed bilevel tree: one bit for each node in the order the nodes are printed, set for splits, then one bit for each leaf, set for black ones.
+
+	With more than one stream or with a static model the extended layout is used. The symbols are split into contiguous chunks, each coded into an independently decodable substream. The highest bit of the width is set to mark this layout, followed by the height, the number of streams, the model ID and the number of colors of the palette on one byte each, the number of symbols on four bytes and the length of each stream in bits on four bytes each. Every stream starts on a byte boundary.
+
+	The code is either built for the file and printed into the .sym file (model ID 0) or taken from one of the static models compiled into the binary, in which case no .sym file is written. Bilevel files with one stream may also be packed, which needs no code at all. By default the cheapest one is chosen.
+	The highest bits of the width and the height mark the layouts, so both are limited to 15 bits and larger images are rejected.
 	\param Input filename.
+	\param Number of streams.
+	\param Model ID, or -1 to choose automatically.
+	\return False if the image is wider or higher than 32767 pixels, in which case no file is written.
 	*/
-void huffman(std::string);
-//!
+bool huffman(std::string, int = 1, int = -1);
+//! Decodes given file.
 /*!
+	Decodes binary .wb file into well-formatted .qd file using the mapping in the .sym file.
 	\param Input filename.
+	\param Number of threads.
+	\return False if the file cannot be decoded, for example because it references a model the binary does not know.
 	*/
-void dehuffman(std::string);
+bool dehuffman(std::string, int = 1);
+//! Builds Huffman code.
+/*!
+	Merges the two least frequent subtrees using a priority queue, then assigns canonical codes from the resulting code lengths.
+	\param Frequency of each character.
+	\return Map from characters to the binary strings of their codes.
+	*/
+std::map<char, std::string> buildCode(const std::map<char, long>&);
+//! Predicts the size of a coded file.
+/*!
+	Makes the same choice of code as huffman() without writing anything.
+	\param Frequency of each character.
+	\param Number of streams.
+	\param Model ID, or -1 to choose automatically.
+	\param Number of colors of the palette.
+	\return Size of the .wb file and the .sym table in bytes, exact for one stream and at most one byte per stream above otherwise.
+	*/
+long codedSize(const std::map<char, long>&, int = 1, int = -1, int = 5);
+//! Reads the character-symbol mapping.
+/*!
+	\param Input filename.
+	\return Map from characters to the binary strings of their codes.
+	*/
+std::map<char, std::string> readSymbols(std::string);
+//! Decodes the symbols of a .wb file in memory.
+/*!
+	Decodes with a lookup table indexed by the next bits of the stream. Substreams are decoded four at a time in one loop, so their dependency chains overlap, and large files are split among the given number of threads.
+	\param Content of the .wb file.
+	\param Character-symbol mapping, ignored when the file references a static model.
+	\param Width of image (output).
+	\param Height of image (output).
+	\param Number of colors of the palette (output), 5 for the legacy layout.
+	\param Number of threads.
+	\return String containing the symbols, empty if the file references an unknown model.
+	*/
+std::string decode(const std::vector<unsigned char>&, const std::map<char, std::string>&, int&, int&, int&, int = 1);
@@ -0,0 +1,57 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include "huff.hpp"
+
+//! Benchmarks decoding of multi-stream files.
+/*!
+	Writes a synthetic .qd file with the symbol distribution of a typical whiteboard, codes it with 1, 4 and 8 streams and reports the decoding speed in GB of symbols per second, on one thread and on one thread per stream. The best of five runs is reported.
+	*/
+int main(int argc, char** argv) {
+	size_t symbols = argc > 1 ? atol(argv[1]) : 1 << 26;
+	std::string filename = "huffbench";
+
+	std::mt19937 gen(1);
+	std::discrete_distribution<int> dist({41, 25, 14, 11, 9});
+	const char alphabet[] = {'w', '|', 'b', 'r', 'k'};
+	std::string data;
+	data.reserve(symbols);
+	for (size_t i = 0; i < symbols; i++)
+		data.push_back(alphabet[dist(gen)]);
+	std::ofstream file(filename + ".qd");
+	file << 4096 << " " << 4096 << data;
+	file.close();
+
+	printf("%zu symbols\n", symbols);
+	for (int streams : {1, 4, 8}) {
+		huffman(filename, streams);
+		std::ifstream in(filename + ".wb", std::ios::binary);
+		std::vector<unsigned char> buffer((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		in.close();
+		std::map<char, std::string> sym = readSymbols(filename);
+		for (int threads : {1, streams}) {
+			double best = 0.0;
+			for (int run = 0; run < 5; run++) {
+				int x, y, palette;
+				auto start = std::chrono::steady_clock::now();
+				std::string result = decode(buffer, sym, x, y, palette, threads);
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				if (result != data) {
+					printf("streams %d threads %d: mismatch\n", streams, threads);
+					return -1;
+				}
+				best = std::max(best, symbols / seconds / 1e9);
+			}
+			printf("streams %d threads %d: %.3f GB/s\n", streams, threads, best);
+			if (streams == 1)
+				break;
+		}
+	}
+
+	remove((filename + ".qd").c_str());
+	remove((filename + ".wb").c_str());
+	remove((filename + ".sym").c_str());
+	return 0;
+}
@@ -0,0 +1,60 @@
+#include <iostream>
+#include "summary.hpp"
+#include "stats.hpp"
+
+//! Prints statistics of .wb files without decoding them into images.
+/*!
+	Prints one JSON object per file with the size, palette, ink area, bounding boxes per color, whether the board is empty and optionally the occupancy grid, which covers the image with ROWS x COLS cells.
+	*/
+int main(int argc, char** argv) {
+
+	bool stats = false;
+	int threads = 1, rows = 0, cols = 0;
+	double empty = 0.0;
+	std::vector<std::string> args;
+
+	for (int i = 1; i < argc; i++)
+		if (std::string(argv[i]) == "--stats")
+			stats = true;
+		else if (std::string(argv[i]) == "-j" && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if (std::string(argv[i]) == "-g" && i + 1 < argc) {
+			std::string grid = argv[++i];
+			rows = atoi(grid.c_str());
+			cols = grid.find('x') != std::string::npos ? atoi(grid.c_str() + grid.find('x') + 1) : rows;
+		} else if (std::string(argv[i]) == "--empty" && i + 1 < argc)
+			empty = atof(argv[++i]);
+		else
+			args.push_back(argv[i]);
+
+	if (args.size() < 1) {
+		printf("USAGE: wbinfo [-g ROWSxCOLS] [--empty FRACTION] [-j THREADS] [--stats] FILENAME...\n");
+		return -1;
+	}
+
+#ifndef WB_STATS
+	if (stats) {
+		fprintf(stderr, "wbinfo: built without statistics, rebuild with make STATS=1\n");
+		return -1;
+	}
+#endif
+
+	int failed = 0;
+	for (unsigned int i = 0; i < args.size(); i++) {
+		std::string filename = args[i].substr(0, args[i].find_last_of("."));
+		STATS_BYTES("bytes_in", filename + ".wb");
+		Summary summary(filename, rows, cols, threads);
+		if (!summary.isValid()) {
+			fprintf(stderr, "wbinfo: cannot decode %s.wb\n", filename.c_str());
+			failed++;
+		}
+		summary.json(args[i], empty, std::cout);
+	}
+
+#ifdef WB_STATS
+	if (stats)
+		Stats::json("wbinfo", std::cerr);
+#endif
+
+	return failed ? -1 : 0;
+}
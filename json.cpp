@@ -0,0 +1,28 @@
+#include <cstdio>
+#include "json.hpp"
+
+std::string quote(const std::string& s) {
+	std::string res = "\"";
+	for (unsigned int i = 0; i < s.size(); i++) {
+		unsigned char c = s[i];
+		if (c == '"' || c == '\\')
+			res += std::string("\\") + s[i];
+		else if (c == '\n')
+			res += "\\n";
+		else if (c == '\r')
+			res += "\\r";
+		else if (c == '\t')
+			res += "\\t";
+		else if (c == '\b')
+			res += "\\b";
+		else if (c == '\f')
+			res += "\\f";
+		else if (c < 0x20) {
+			char escape[7];
+			snprintf(escape, sizeof(escape), "\\u%04x", c);
+			res += escape;
+		} else
+			res += s[i];
+	}
+	return res + "\"";
+}
@@ -0,0 +1,9 @@
+#include <string>
+
+//! Quotes a string for JSON output.
+/*!
+	Escapes quotes and backslashes, writes newlines, carriage returns, tabs, backspaces and form feeds as their short escapes and the other control characters as \u00XX, so any filename gives a valid string.
+	\param String.
+	\return JSON string literal including the quotes.
+	*/
+std::string quote(const std::string&);
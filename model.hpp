@@ -0,0 +1,18 @@
+#include <array>
+
+//! Code of a character in a static model.
+struct ModelCode {
+	char symbol; /*!< Character. */
+	unsigned int code; /*!< Bits of the code. */
+	int length; /*!< Length of the code. */
+};
+
+//! Static entropy model.
+/*!
+	Models are trained by wbtrain on a corpus of .qd files and compiled into the binaries, so files coded with them store the model ID in the .wb header instead of carrying a .sym table. The code behind an ID never changes: retraining appends models with new IDs, and files referencing an ID the binary does not know are rejected.
+	*/
+struct Model {
+	int id; /*!< ID stored in the .wb header. */
+	int size; /*!< Number of codes. */
+	ModelCode codes[16]; /*!< Canonical codes ordered by length. */
+};
@@ -0,0 +1,10 @@
+// Generated by wbtrain, do not edit.
+#include "model.hpp"
+
+//! Lowest ID not given to a model yet. IDs below it missing from models were retired.
+constexpr int nextModel = 1;
+
+constexpr std::array<Model, 0> models = {{
+}};
+
+constexpr int modelCount = models.size();
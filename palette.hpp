@@ -0,0 +1,74 @@
+#include <opencv2/opencv.hpp>
+#include "color.hpp"
+
+//! Distance of an average color from a color of the palettes.
+/*!
+	\param Average BGR color.
+	\param Color enum.
+	\return Maximum of the differences of the channels, truncated.
+	*/
+inline int distance(const cv::Vec3f& s, Color c) {
+	return std::max(std::fabs(s[0] - colorValues[(int)c][0]), std::max(std::fabs(s[1] - colorValues[(int)c][1]), std::fabs(s[2] - colorValues[(int)c][2])));
+}
+
+//! Palette of black ink on a white board.
+/*!
+	Leaves are classified as the closer one of BLACK and WHITE with the maximum metric, like the Standard palette classifies the leaves it calls black or white, so a board using only these two renders the same with both.
+	*/
+struct Bilevel {
+	static const int id = 2; /*!< Number of colors, stored in the files. */
+	static const int index = 0; /*!< Slot of the classified color in the nodes. */
+	//! Converts an average color to the Color enum.
+	/*!
+		\param Average BGR color.
+		\return BLACK or WHITE.
+		*/
+	static Color classify(const cv::Vec3f& s) {
+		return distance(s, Color::BLACK) <= distance(s, Color::WHITE) ? Color::BLACK : Color::WHITE;
+	}
+};
+
+//! Palette of the black, blue, green and red markers.
+struct Standard {
+	static const int id = 5; /*!< Number of colors, stored in the files. */
+	static const int index = 1; /*!< Slot of the classified color in the nodes. */
+	//! Converts an average color to the Color enum.
+	/*!
+		The input parameter is converted to the closest of BLACK, BLUE, GREEN, RED and WHITE with the maximum metric.
+		\param Average BGR color.
+		\return Color enum.
+		*/
+	static Color classify(const cv::Vec3f& s) {
+		Color best = Color::BLACK;
+		int min = 256;
+		for (int c = (int)Color::BLACK; c <= (int)Color::WHITE; c++) {
+			int d = distance(s, static_cast<Color>(c));
+			if (d < min) {
+				min = d;
+				best = static_cast<Color>(c);
+			}
+		}
+		return best;
+	}
+};
+
+//! Palette of the corners of the RGB cube.
+/*!
+	Adds CYAN, MAGENTA and YELLOW for boards with extra marker colors. Only saturated colors are taken for them, everything else is classified like with the Standard palette, so tinted lighting of a white board stays white.
+	*/
+struct Extended {
+	static const int id = 8; /*!< Number of colors, stored in the files. */
+	static const int index = 2; /*!< Slot of the classified color in the nodes. */
+	static const int saturation = 64; /*!< Maximum distance of a CYAN, MAGENTA or YELLOW color from its corner. */
+	//! Converts an average color to the Color enum.
+	/*!
+		Each channel is rounded to 0 or 255 independently, which gives the closest corner. CYAN, MAGENTA and YELLOW are returned if the color is close to the corner, otherwise the color is classified with the Standard palette.
+		\param Average BGR color.
+		\return Color enum.
+		*/
+	static Color classify(const cv::Vec3f& s) {
+		static const Color corners[] = {Color::BLACK, Color::BLUE, Color::GREEN, Color::CYAN, Color::RED, Color::MAGENTA, Color::YELLOW, Color::WHITE};
+		Color c = corners[(s[0] >= 128) | (s[1] >= 128) << 1 | (s[2] >= 128) << 2];
+		return (int)c > (int)Color::WHITE && distance(s, c) < saturation ? c : Standard::classify(s);
+	}
+};
@@ -1,111 +1,65 @@
 #include <string>
+#include <cctype>
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <thread>
 #include "quad.hpp"
+#include "stats.hpp"
 
-double QuadTree::Node::diffThreshold = 45.0;
+double QuadTree::diffThreshold = 45.0;
 
-std::map<char, Color> QuadTree::Node::colorMap = QuadTree::Node::initializeColorMap();
+QuadTree::Node::Node() : range(std::numeric_limits<float>::infinity()), colors{Color::WHITE, Color::WHITE, Color::WHITE}, nw(nullptr), ne(nullptr), sw(nullptr), se(nullptr) {}
 
-std::map<char, Color> QuadTree::Node::initializeColorMap() {
-	std::map<char, Color> res;
-	res['k'] = Color::BLACK;
-	res['b'] = Color::BLUE;
-	res['g'] = Color::GREEN;
-	res['r'] = Color::RED;
-	res['w'] = Color::WHITE;
-	return res;
-}
-
-QuadTree::Node::Node() : nw(nullptr), ne(nullptr), sw(nullptr), se(nullptr) {}
-
-QuadTree::Node::Node(cv::Mat image) : Node() {
-	cv::Scalar mean, dev;
-	cv::meanStdDev(image, mean, dev);
+QuadTree::Node::Node(cv::Mat image, double threshold) : Node() {
+	cv::Scalar avg, dev;
+	cv::meanStdDev(image, avg, dev);
 	int r = image.rows / 2, c = image.cols / 2;
 	double min, max;
 	cv::minMaxLoc(image, &min, &max);
-	if (r != 0 && c != 0 && (max - min) > diffThreshold) {
-		nw = new Node(image(cv::Range(0, r), cv::Range(0, c)));
-		ne = new Node(image(cv::Range(0, r), cv::Range(c, image.cols)));
-		sw = new Node(image(cv::Range(r, image.rows), cv::Range(0, c)));
-		se = new Node(image(cv::Range(r, image.rows), cv::Range(c, image.cols)));
-	} else
-		color = scalar2Color(mean);
+	range = max - min;
+	classify(cv::Vec3f(avg[0], avg[1], avg[2]));
+	if (r != 0 && c != 0 && range > threshold) {
+		nw = new Node(image(cv::Range(0, r), cv::Range(0, c)), threshold);
+		ne = new Node(image(cv::Range(0, r), cv::Range(c, image.cols)), threshold);
+		sw = new Node(image(cv::Range(r, image.rows), cv::Range(0, c)), threshold);
+		se = new Node(image(cv::Range(r, image.rows), cv::Range(c, image.cols)), threshold);
+	}
 }
 
-QuadTree::Node::Node(std::ifstream& file) : Node() {
-	char tmp;
-	file >> tmp;
+QuadTree::Node::Node(const char*& p) : Node() {
+	char tmp = *p;
+	if (tmp != '\0')
+		p++;
 	if (tmp == '|') {
-		nw = new Node(file);
-		ne = new Node(file);
-		sw = new Node(file);
-		se = new Node(file);
+		nw = new Node(p);
+		ne = new Node(p);
+		sw = new Node(p);
+		se = new Node(p);
 	} else
 		setColor(tmp);
 }
 
 void QuadTree::Node::setColor(char _color) {
-	color = QuadTree::Node::colorMap[_color];
+	const unsigned char* value = colorValues[(int)char2Color(_color)];
+	classify(cv::Vec3f(value[0], value[1], value[2]));
 }
 
-Color QuadTree::Node::scalar2Color(cv::Scalar s) {
-	std::vector<int> v;
-	v.push_back(cv::norm(s - cv::Scalar(0, 0, 0), cv::NORM_INF));
-	cv::Scalar c;
-	for (int i = 0; i < 3; i++) {
-		c = cv::Scalar(0, 0, 0);
-		c[i] = 255;
-		v.push_back(cv::norm(s - c, cv::NORM_INF));
-	}
-	v.push_back(cv::norm(s - cv::Scalar(255, 255, 255), cv::NORM_INF));
-	return static_cast<Color>(std::distance(v.begin(), std::min_element(v.begin(), v.end())));
+void QuadTree::Node::classify(const cv::Vec3f& mean) {
+	colors[Bilevel::index] = Bilevel::classify(mean);
+	colors[Standard::index] = Standard::classify(mean);
+	colors[Extended::index] = Extended::classify(mean);
 }
 
-cv::Scalar QuadTree::Node::color2Scalar(Color c) {
-	cv::Scalar s;
-	switch (c) {
-		case Color::BLACK:
-			s = cv::Scalar(0, 0, 0);
-			break;
-		case Color::BLUE:
-			s = cv::Scalar(255, 0, 0);
-			break;
-		case Color::GREEN:
-			s = cv::Scalar(0, 255, 0);
-			break;
-		case Color::RED:
-			s = cv::Scalar(0, 0, 255);
-			break;
-		case Color::WHITE:
-			s = cv::Scalar(255, 255, 255);
-			break;
-		default:
-			s = cv::Scalar(255, 255, 255);
-			break;
-	}
-	return s;
+template<class Palette>
+cv::Scalar QuadTree::Node::color2Scalar() {
+	const unsigned char* value = colorValues[(int)colors[Palette::index]];
+	return cv::Scalar(value[0], value[1], value[2]);
 }
 
-char QuadTree::Node::color2String(Color c) {
-	char s;
-	switch(c) {
-		case Color::BLACK:
-			s = 'k';
-			break;
-		case Color::BLUE:
-			s = 'b';
-			break;
-		case Color::GREEN:
-			s = 'g';
-			break;
-		case Color::RED:
-			s = 'r';
-			break;
-		case Color::WHITE:
-			s = 'w';
-			break;
-	}
-	return s;
+template<class Palette>
+char QuadTree::Node::color2String() {
+	return colorChars[(int)colors[Palette::index]];
 }
 
 void QuadTree::Node::destroy() {
@@ -119,34 +73,400 @@ void QuadTree::Node::destroy() {
 	(void*)0;
 }
 
-void QuadTree::Node::print(std::ofstream& file) {
-	if (nw != nullptr) {
+bool QuadTree::Node::leaf(double threshold) {
+	return nw == nullptr || range <= threshold;
+}
+
+template<class Palette>
+void QuadTree::Node::print(std::ofstream& file, double threshold) {
+	if (!leaf(threshold)) {
 		file << "|";
-		nw->print(file);
-		ne->print(file);
-		sw->print(file);
-		se->print(file);
+		nw->print<Palette>(file, threshold);
+		ne->print<Palette>(file, threshold);
+		sw->print<Palette>(file, threshold);
+		se->print<Palette>(file, threshold);
 	} else
-		file << color2String(color);
+		file << color2String<Palette>();
 }
 
-QuadTree::QuadTree(std::string filename) {
-	std::ifstream file(filename + std::string(".qd"));
-	file >> size_x >> size_y;
-	root = new Node(file);
-	file.close();
+template<class Palette>
+void QuadTree::Node::count(double threshold, std::map<char, long>& freq) {
+	if (!leaf(threshold)) {
+		freq['|']++;
+		nw->count<Palette>(threshold, freq);
+		ne->count<Palette>(threshold, freq);
+		sw->count<Palette>(threshold, freq);
+		se->count<Palette>(threshold, freq);
+	} else
+		freq[color2String<Palette>()]++;
+}
+
+void QuadTree::Node::coverage(int x, int y, double threshold, std::vector<long>& area) {
+	if (!leaf(threshold)) {
+		int r = y / 2, c = x / 2;
+		nw->coverage(c, r, threshold, area);
+		ne->coverage(x - c, r, threshold, area);
+		sw->coverage(c, y - r, threshold, area);
+		se->coverage(x - c, y - r, threshold, area);
+	} else
+		area[(int)colors[Extended::index]] += (long)x * y;
+}
+
+template<class Palette>
+bool QuadTree::Node::sample(cv::Rect region, cv::Rect rect, double threshold, long* area, bool stop) {
+	cv::Rect overlap = region & rect;
+	if (overlap.area() <= 0)
+		return true;
+	if (leaf(threshold)) {
+		area[(int)colors[Palette::index]] += overlap.area();
+		return !stop || std::count_if(area, area + 8, [](long a) {return a > 0;}) < 2;
+	}
+	int r = region.height / 2, c = region.width / 2;
+	return nw->sample<Palette>(cv::Rect(region.x, region.y, c, r), rect, threshold, area, stop)
+		&& ne->sample<Palette>(cv::Rect(region.x + c, region.y, region.width - c, r), rect, threshold, area, stop)
+		&& sw->sample<Palette>(cv::Rect(region.x, region.y + r, c, region.height - r), rect, threshold, area, stop)
+		&& se->sample<Palette>(cv::Rect(region.x + c, region.y + r, region.width - c, region.height - r), rect, threshold, area, stop);
+}
+
+void QuadTree::Node::cover(cv::Rect region, cv::Rect rect, double threshold, std::vector<std::pair<Node*, cv::Rect>>& nodes) {
+	cv::Rect overlap = region & rect;
+	if (overlap.area() <= 0)
+		return;
+	if (leaf(threshold) || overlap.area() == region.area()) {
+		nodes.push_back(std::make_pair(this, region));
+		return;
+	}
+	int r = region.height / 2, c = region.width / 2;
+	nw->cover(cv::Rect(region.x, region.y, c, r), rect, threshold, nodes);
+	ne->cover(cv::Rect(region.x + c, region.y, region.width - c, r), rect, threshold, nodes);
+	sw->cover(cv::Rect(region.x, region.y + r, c, region.height - r), rect, threshold, nodes);
+	se->cover(cv::Rect(region.x + c, region.y + r, region.width - c, region.height - r), rect, threshold, nodes);
 }
 
-QuadTree::QuadTree(cv::Mat image) {
+bool QuadTree::Node::even(int x, int y, bool width, bool height, double threshold) {
+	if (leaf(threshold))
+		return true;
+	if ((width && x % 2) || (height && y % 2))
+		return false;
+	int r = y / 2, c = x / 2;
+	return nw->even(c, r, width, height, threshold) && ne->even(x - c, r, width, height, threshold)
+		&& sw->even(c, y - r, width, height, threshold) && se->even(x - c, y - r, width, height, threshold);
+}
+
+template<class Palette>
+void QuadTree::Node::permute(const int* order, double threshold) {
+	if (nw == nullptr)
+		return;
+	Node* children[] = {nw, ne, sw, se};
+	if (!leaf(threshold)) {
+		nw = children[order[0]];
+		ne = children[order[1]];
+		sw = children[order[2]];
+		se = children[order[3]];
+		bool uniform = true;
+		for (int i = 0; i < 4; i++) {
+			children[i]->permute<Palette>(order, threshold);
+			uniform = uniform && children[i]->nw == nullptr && children[i]->colors[Palette::index] == children[0]->colors[Palette::index];
+		}
+		if (!uniform)
+			return;
+		std::copy(children[0]->colors, children[0]->colors + 3, colors);
+	}
+	for (int i = 0; i < 4; i++)
+		children[i]->destroy();
+	nw = ne = sw = se = nullptr;
+}
+
+QuadTree::QuadTree(std::string filename, int threads) : threshold(diffThreshold), floor(0.0), palette(Standard::id) {
+	{
+		STATS_TIMER("parse");
+		std::ifstream file(filename + std::string(".qd"));
+		file >> size_x >> size_y >> std::ws;
+		if (std::isdigit(file.peek()))
+			file >> palette;
+		std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		file.close();
+		const char* p = data.c_str();
+		if (threads <= 1)
+			root = new Node(p);
+		else {
+			std::vector<std::pair<Node**, const char*>> tasks;
+			plan(&root, p, taskDepth(threads), tasks);
+			parallel(tasks.size(), threads, [&tasks](size_t i) {
+				const char* q = tasks[i].second;
+				*tasks[i].first = new Node(q);
+			});
+		}
+	}
+}
+
+void QuadTree::plan(Node** node, const char*& p, int depth, std::vector<std::pair<Node**, const char*>>& tasks) {
+	if (depth == 0 || *p != '|') {
+		tasks.push_back(std::make_pair(node, p));
+		p = skip(p);
+		return;
+	}
+	p++;
+	*node = new Node();
+	plan(&(*node)->nw, p, depth - 1, tasks);
+	plan(&(*node)->ne, p, depth - 1, tasks);
+	plan(&(*node)->sw, p, depth - 1, tasks);
+	plan(&(*node)->se, p, depth - 1, tasks);
+}
+
+const char* QuadTree::skip(const char* p) {
+	for (long left = 1; left > 0 && *p != '\0'; p++)
+		left += *p == '|' ? 3 : -1;
+	return p;
+}
+
+void QuadTree::parallel(size_t tasks, int threads, std::function<void(size_t)> run) {
+	std::atomic<size_t> next(0);
+	auto work = [&next, tasks, &run]() {
+		for (size_t i = next++; i < tasks; i = next++)
+			run(i);
+	};
+	std::vector<std::thread> workers;
+	for (int t = 1; t < threads; t++)
+		workers.push_back(std::thread(work));
+	work();
+	for (unsigned int t = 0; t < workers.size(); t++)
+		workers[t].join();
+}
+
+int QuadTree::taskDepth(int threads) {
+	int depth = 1;
+	while ((1 << 2 * depth) < 4 * threads)
+		depth++;
+	return depth;
+}
+
+QuadTree::QuadTree(cv::Mat image) : QuadTree(image, diffThreshold) {}
+
+QuadTree::QuadTree(cv::Mat image, double _floor) : threshold(std::max(diffThreshold, _floor)), floor(_floor), palette(Standard::id) {
 	size_x = image.cols;
 	size_y = image.rows;
-	root = new Node(image);
+	{
+		STATS_TIMER("quadtree");
+		root = new Node(image, floor);
+	}
+}
+
+void QuadTree::setThreshold(double _threshold) {
+	threshold = std::max(_threshold, floor);
+}
+
+double QuadTree::getThreshold() {
+	return threshold;
 }
 
+int QuadTree::search(std::function<bool()> condition) {
+	int low = std::ceil(floor), high = 256;
+	while (low < high) {
+		int middle = (low + high) / 2;
+		setThreshold(middle);
+		if (condition())
+			high = middle;
+		else
+			low = middle + 1;
+	}
+	return low;
+}
+
+bool QuadTree::fitSize(std::function<long(const std::map<char, long>&)> size, long budget) {
+	int t = search([this, &size, budget]() {return size(symbols()) <= budget;});
+	setThreshold(std::min(t, 255));
+	return t <= 255;
+}
+
+bool QuadTree::fitQuality(cv::Mat image, double quality) {
+	int t = search([this, &image, quality]() {return cv::PSNR(image, getImage(false)) < quality;});
+	setThreshold(std::max<double>(t - 1, floor));
+	return t > std::ceil(floor);
+}
+
+std::map<char, long> QuadTree::symbols() {
+	std::map<char, long> freq;
+	visit([&](auto p) {root->count<decltype(p)>(threshold, freq);});
+	return freq;
+}
+
+template<class F>
+void QuadTree::visit(F f) {
+	if (palette == Bilevel::id)
+		f(Bilevel());
+	else if (palette == Extended::id)
+		f(Extended());
+	else
+		f(Standard());
+}
+
+void QuadTree::setPalette(int palette) {
+	this->palette = palette == Bilevel::id || palette == Extended::id ? palette : Standard::id;
+}
+
+int QuadTree::getPalette() {
+	return palette;
+}
+
+int QuadTree::detectPalette() {
+	std::vector<long> area(8, 0);
+	root->coverage(size_x, size_y, threshold, area);
+	long total = (long)size_x * size_y;
+	int used = 0;
+	for (int c = 0; c < 8; c++)
+		if (area[c] > 0 && area[c] * 10000 >= total)
+			used |= 1 << c;
+	if ((used & ~(1 << (int)Color::BLACK | 1 << (int)Color::WHITE)) == 0)
+		return Bilevel::id;
+	if ((used & ~0x1f) == 0)
+		return Standard::id;
+	return Extended::id;
+}
+
+template<class Palette>
+QuadTree::Node* QuadTree::remap(cv::Rect region, const std::function<cv::Rect(cv::Rect)>& source, const std::vector<std::pair<Node*, cv::Rect>>& nodes) {
+	Node* node = new Node();
+	long area[8] = {0};
+	bool pixel = region.width <= 1 && region.height <= 1;
+	cv::Rect rect = source(region);
+	std::vector<std::pair<Node*, cv::Rect>> cover;
+	for (unsigned int i = 0; i < nodes.size(); i++)
+		nodes[i].first->cover(nodes[i].second, rect, threshold, cover);
+	for (unsigned int i = 0; i < cover.size(); i++)
+		if (!cover[i].first->sample<Palette>(cover[i].second, rect, threshold, area, !pixel))
+			break;
+	if (pixel || std::count_if(area, area + 8, [](long a) {return a > 0;}) < 2) {
+		int best = (int)Color::WHITE;
+		for (int c = 0; c < 8; c++)
+			if (area[c] > area[best])
+				best = c;
+		node->setColor(colorChars[best]);
+		return node;
+	}
+	int r = region.height / 2, c = region.width / 2;
+	node->nw = remap<Palette>(cv::Rect(region.x, region.y, c, r), source, cover);
+	node->ne = remap<Palette>(cv::Rect(region.x + c, region.y, region.width - c, r), source, cover);
+	node->sw = remap<Palette>(cv::Rect(region.x, region.y + r, c, region.height - r), source, cover);
+	node->se = remap<Palette>(cv::Rect(region.x + c, region.y + r, region.width - c, region.height - r), source, cover);
+	return node;
+}
+
+void QuadTree::transform(int width, int height, std::function<cv::Rect(cv::Rect)> source) {
+	STATS_TIMER("transform");
+	Node* node = nullptr;
+	std::vector<std::pair<Node*, cv::Rect>> nodes(1, std::make_pair(root, cv::Rect(0, 0, size_x, size_y)));
+	visit([&](auto p) {node = remap<decltype(p)>(cv::Rect(0, 0, width, height), source, nodes);});
+	root->destroy();
+	root = node;
+	size_x = width;
+	size_y = height;
+}
+
+bool QuadTree::permute(const int* order, bool width, bool height, int x, int y) {
+	if (!root->even(size_x, size_y, width, height, threshold))
+		return false;
+	STATS_TIMER("transform");
+	visit([&](auto p) {root->permute<decltype(p)>(order, threshold);});
+	size_x = x;
+	size_y = y;
+	return true;
+}
+
+void QuadTree::rotate(int quarters) {
+	static const int orders[][4] = {{0, 1, 2, 3}, {2, 0, 3, 1}, {3, 2, 1, 0}, {1, 3, 0, 2}};
+	int w = size_x, h = size_y, q = (quarters % 4 + 4) % 4;
+	if (q != 0 && permute(orders[q], q != 1, q != 3, q % 2 ? h : w, q % 2 ? w : h))
+		return;
+	switch (q) {
+		case 1:
+			transform(h, w, [h](cv::Rect r) {return cv::Rect(r.y, h - r.x - r.width, r.height, r.width);});
+			break;
+		case 2:
+			transform(w, h, [w, h](cv::Rect r) {return cv::Rect(w - r.x - r.width, h - r.y - r.height, r.width, r.height);});
+			break;
+		case 3:
+			transform(h, w, [w](cv::Rect r) {return cv::Rect(w - r.y - r.height, r.x, r.height, r.width);});
+			break;
+	}
+}
+
+void QuadTree::flip(bool horizontal) {
+	static const int orders[][4] = {{2, 3, 0, 1}, {1, 0, 3, 2}};
+	int w = size_x, h = size_y;
+	if (permute(orders[horizontal], horizontal, !horizontal, w, h))
+		return;
+	if (horizontal)
+		transform(w, h, [w](cv::Rect r) {return cv::Rect(w - r.x - r.width, r.y, r.width, r.height);});
+	else
+		transform(w, h, [h](cv::Rect r) {return cv::Rect(r.x, h - r.y - r.height, r.width, r.height);});
+}
+
+bool QuadTree::crop(std::string path) {
+	Node** node = &root;
+	int w = size_x, h = size_y;
+	for (unsigned int i = 0; i < path.size(); i++) {
+		if (!std::isalpha(path[i]))
+			continue;
+		if (i + 1 >= path.size() || (path[i] != 'n' && path[i] != 's') || (path[i + 1] != 'w' && path[i + 1] != 'e'))
+			return false;
+		bool south = path[i] == 's', east = path[++i] == 'e';
+		int r = h / 2, c = w / 2;
+		w = east ? w - c : c;
+		h = south ? h - r : r;
+		if (!(*node)->leaf(threshold))
+			node = south ? (east ? &(*node)->se : &(*node)->sw) : (east ? &(*node)->ne : &(*node)->nw);
+	}
+	if (w == 0 || h == 0)
+		return false;
+	Node* quadrant = *node;
+	if (quadrant != root) {
+		*node = new Node();
+		root->destroy();
+		root = quadrant;
+	}
+	size_x = w;
+	size_y = h;
+	return true;
+}
+
+void QuadTree::downsample(int levels) {
+	levels = std::min(levels, 16);
+	if (levels <= 0)
+		return;
+	int w = (size_x + (1 << levels) - 1) >> levels, h = (size_y + (1 << levels) - 1) >> levels;
+	transform(w, h, [levels](cv::Rect r) {return cv::Rect(r.x << levels, r.y << levels, r.width << levels, r.height << levels);});
+}
+
+void QuadTree::measure() {
+#ifdef WB_STATS
+	long nodes = 0, leaves = 0;
+	root->measure(0, threshold, nodes, leaves);
+	STATS_COUNT("nodes", nodes);
+	STATS_COUNT("leaves", leaves);
+#endif
+}
+
+#ifdef WB_STATS
+void QuadTree::Node::measure(int depth, double threshold, long& nodes, long& leaves) {
+	nodes++;
+	if (!leaf(threshold)) {
+		nw->measure(depth + 1, threshold, nodes, leaves);
+		ne->measure(depth + 1, threshold, nodes, leaves);
+		sw->measure(depth + 1, threshold, nodes, leaves);
+		se->measure(depth + 1, threshold, nodes, leaves);
+	} else {
+		leaves++;
+		STATS_DEPTH(depth);
+	}
+}
+#endif
+
 void QuadTree::print(std::string filename) {
+	STATS_TIMER("serialize");
 	std::ofstream file(filename + std::string(".qd"));
-	file << size_x << " " << size_y;
-	root->print(file);
+	file << size_x << " " << size_y << " " << palette;
+	visit([&](auto p) {root->print<decltype(p)>(file, threshold);});
 	file.close();
 }
 
@@ -154,23 +474,58 @@ QuadTree::~QuadTree() {
 	root->destroy();
 }
 
-cv::Mat QuadTree::Node::compose(int x, int y, bool grid) {
-	cv::Mat image(y, x, CV_8UC3);
-	if (nw != nullptr) {
-		int r = image.rows / 2, c = image.cols / 2;	
-		nw->compose(c, r, grid).copyTo(image(cv::Range(0, r), cv::Range(0, c)));
-		ne->compose(image.cols - c, r, grid).copyTo(image(cv::Range(0, r), cv::Range(c, image.cols)));
-		sw->compose(c, image.rows - r, grid).copyTo(image(cv::Range(r, image.rows), cv::Range(0, c)));
-		se->compose(image.cols - c, image.rows - r, grid).copyTo(image(cv::Range(r, image.rows), cv::Range(c, image.cols)));
-		if (grid) {
-			cv::line(image, cv::Point(0, r), cv::Point(image.cols, r), cv::Scalar(255, 0, 0), 1, cv::LINE_AA);
-			cv::line(image, cv::Point(c, 0), cv::Point(c, image.rows), cv::Scalar(255, 0, 0), 1, cv::LINE_AA);
-		}
+template<class Palette>
+void QuadTree::Node::render(cv::Mat image, bool grid, double threshold) {
+	if (!leaf(threshold)) {
+		int r = image.rows / 2, c = image.cols / 2;
+		nw->render<Palette>(image(cv::Range(0, r), cv::Range(0, c)), grid, threshold);
+		ne->render<Palette>(image(cv::Range(0, r), cv::Range(c, image.cols)), grid, threshold);
+		sw->render<Palette>(image(cv::Range(r, image.rows), cv::Range(0, c)), grid, threshold);
+		se->render<Palette>(image(cv::Range(r, image.rows), cv::Range(c, image.cols)), grid, threshold);
+		if (grid)
+			Node::grid(image);
 	} else
-		image = color2Scalar(color);
-	return image;
+		image = color2Scalar<Palette>();
+}
+
+void QuadTree::Node::split(cv::Mat image, int depth, double threshold, std::vector<std::pair<Node*, cv::Mat>>& tasks, std::vector<cv::Mat>& grids) {
+	if (depth == 0 || leaf(threshold)) {
+		tasks.push_back(std::make_pair(this, image));
+		return;
+	}
+	int r = image.rows / 2, c = image.cols / 2;
+	nw->split(image(cv::Range(0, r), cv::Range(0, c)), depth - 1, threshold, tasks, grids);
+	ne->split(image(cv::Range(0, r), cv::Range(c, image.cols)), depth - 1, threshold, tasks, grids);
+	sw->split(image(cv::Range(r, image.rows), cv::Range(0, c)), depth - 1, threshold, tasks, grids);
+	se->split(image(cv::Range(r, image.rows), cv::Range(c, image.cols)), depth - 1, threshold, tasks, grids);
+	grids.push_back(image);
 }
 
-cv::Mat QuadTree::getImage(bool grid) {
-	return root->compose(size_x, size_y, grid);
+void QuadTree::Node::grid(cv::Mat image) {
+	int r = image.rows / 2, c = image.cols / 2;
+	cv::line(image, cv::Point(0, r), cv::Point(image.cols, r), cv::Scalar(255, 0, 0), 1, cv::LINE_AA);
+	cv::line(image, cv::Point(c, 0), cv::Point(c, image.rows), cv::Scalar(255, 0, 0), 1, cv::LINE_AA);
+}
+
+cv::Mat QuadTree::getImage(bool grid, int threads) {
+	STATS_TIMER("render");
+	cv::Mat image(size_y, size_x, CV_8UC3);
+	if (threads <= 1) {
+		visit([&](auto p) {root->render<decltype(p)>(image, grid, threshold);});
+		return image;
+	}
+	std::vector<std::pair<Node*, cv::Mat>> tasks;
+	std::vector<cv::Mat> grids;
+	root->split(image, taskDepth(threads), threshold, tasks, grids);
+	double threshold = this->threshold;
+	visit([&](auto p) {
+		typedef decltype(p) Palette;
+		parallel(tasks.size(), threads, [&tasks, grid, threshold](size_t i) {
+			tasks[i].first->render<Palette>(tasks[i].second, grid, threshold);
+		});
+	});
+	if (grid)
+		for (unsigned int i = 0; i < grids.size(); i++)
+			Node::grid(grids[i]);
+	return image;
 }
@@ -1,7 +1,11 @@
 #include <opencv2/opencv.hpp>
 #include <fstream>
+#include <functional>
+#include <limits>
 #include <map>
-#include "color.hpp"
+#include <vector>
+#include <utility>
+#include "palette.hpp"
 
 //! Class representing a quadtree.
 /*!
@@ -11,58 +15,79 @@ class QuadTree {
 	private:
 		//! Class for node representation.
 		/*!
-			Each node contains pointers to its childrens and its color. Then a pointer for the root node is stored in this class.
+			Each node contains pointers to its childrens, its color and the maximum difference of its region. Then a pointer for the root node is stored in this class. The average color is classified with every palette when the node is built, so the palette can be chosen later while the node keeps one byte per palette instead of the average.
 			*/
 		class Node {
 			private:
-				Color color; /*!< Color variable. */
-				static double diffThreshold; /*!< Threshold for the maximum difference of a region. */
-				static std::map<char, Color> colorMap; /*!< Maps characters to the Color enum. */
-				static std::map<char, Color> initializeColorMap(); /*!< Initializes the static coloMap. */
-				//! Converts a cv::Scalar variable to a Color enum.
+				float range; /*!< Maximum difference of the region. */
+				Color colors[3]; /*!< Color of the region classified with each palette, indexed by the index of the palette. */
+				//! Classifies an average color with every palette.
 				/*!
-					The input parameter is converted to the closest predefined color with the Euclidian metric.
-					\param cv::Scalar value.
-					\return Color enum.
+					\param Average BGR color.
 					*/
-				Color scalar2Color(cv::Scalar);
-				//! Converts a Color variable to char.
+				void classify(const cv::Vec3f&);
+				//! Converts the color to char.
 				/*!
-					The input parameter is converted to the corresponding char.
-					\param Color value.
-					\return char enum.
+					The color classified with the palette is converted to the corresponding char.
+					\return char of the color.
 					*/
-				char color2String(Color);
-				//! Converts a Color variable to cv::Scalar.
+				template<class Palette>
+				char color2String();
+				//! Converts the color to cv::Scalar.
 				/*!
-					\param Color enum.
+					The color classified with the palette is converted to the corresponding BGR value.
 					\return cv::Scalar value.
 					*/
-				cv::Scalar color2Scalar(Color);
+				template<class Palette>
+				cv::Scalar color2Scalar();
 			public:
-				//! Composes image stored in node.
+				//! Checks whether the node is a leaf at the given threshold.
 				/*!
-					\param Width of region.
-					\param Height of region.
+					\param Threshold for the maximum difference of a region.
+					\return True if the node has no children or its region is uniform enough.
+					*/
+				bool leaf(double);
+				//! Renders image stored in node.
+				/*!
+					Writes directly into the given region of the output image.
+					\param cv::Mat object referencing the region.
 					\param Boolean about drawing the boundaries of the node.
-					\return cv::Mat object containing the image.
+					\param Threshold for the maximum difference of a region.
+					*/
+				template<class Palette>
+				void render(cv::Mat, bool, double);
+				//! Splits rendering into independent regions.
+				/*!
+					Collects the subtrees on the given depth together with their regions, and the regions of the nodes above them whose boundaries are drawn once the subtrees are rendered.
+					\param cv::Mat object referencing the region.
+					\param Remaining depth.
+					\param Threshold for the maximum difference of a region.
+					\param Vector of subtrees and their regions.
+					\param Vector of regions of the nodes above, children first.
+					*/
+				void split(cv::Mat, int, double, std::vector<std::pair<Node*, cv::Mat>>&, std::vector<cv::Mat>&);
+				//! Draws the boundaries of the children of a region.
+				/*!
+					\param cv::Mat object referencing the region.
 					*/
-				cv::Mat compose(int, int, bool);
+				static void grid(cv::Mat);
 				//! Constructor
 				/*!
-					Initializes childs to nullptr.
+					Initializes childs to nullptr, the color to white and the maximum difference to infinity, so nodes with children are kept at any threshold unless built from an image.
 					*/
 				Node();
-				//! Constructor with file.
+				//! Constructor with buffer.
 				/*!
-					\param Input file handle.
+					\param Position in the buffer, moved past the node.
 					*/
-				Node(std::ifstream&);
+				Node(const char*&);
 				//! Constructor with image.
 				/*!
-					Decomposes the image if the maximum difference is above the given threshold, otherwise converts the average color to the Color enum.
+					Decomposes the image if the maximum difference is above the given threshold. The color is kept on every node, so the tree can be pruned later at any higher threshold.
+					\param cv::Mat object containing the image.
+					\param Threshold for the maximum difference of a region.
 					*/
-				Node(cv::Mat);
+				Node(cv::Mat, double);
 				//! Destructor.
 				~Node() = default;
 				Node* nw, /*!< Northwest child. */
@@ -73,45 +98,279 @@ class QuadTree {
 				void destroy();
 				//! Print node to file.
 				/*!
-					The character | denotes the existence of child nodes and a single character denotes the predefined colors (w, b, r, g, k).
+					The character | denotes the existence of child nodes and a single character denotes the predefined colors (w, b, r, g, k, c, m, y).
 					\param Output file handle.
+					\param Threshold for the maximum difference of a region.
+					*/
+				template<class Palette>
+				void print(std::ofstream&, double);
+				//! Count the characters printed for the subtree.
+				/*!
+					\param Threshold for the maximum difference of a region.
+					\param Frequency of each character.
 					*/
-				void print(std::ofstream&);
+				template<class Palette>
+				void count(double, std::map<char, long>&);
+				//! Sum the area of the leaves of each color.
+				/*!
+					Classifies with the Extended palette, which contains all the colors.
+					\param Width of region.
+					\param Height of region.
+					\param Threshold for the maximum difference of a region.
+					\param Area of each color, indexed by the Color enum.
+					*/
+				void coverage(int, int, double, std::vector<long>&);
+				//! Sum the area of the leaves of each color inside a rectangle.
+				/*!
+					\param Region of the node.
+					\param Rectangle.
+					\param Threshold for the maximum difference of a region.
+					\param Area of each color, indexed by the Color enum.
+					\param Boolean about stopping once two colors are found.
+					\return False if stopped.
+					*/
+				template<class Palette>
+				bool sample(cv::Rect, cv::Rect, double, long*, bool);
+				//! Collects the nodes covering a rectangle.
+				/*!
+					Descends into the nodes crossing the border of the rectangle and collects the leaves and the nodes inside it, so the rectangle and every rectangle inside it can be sampled from them instead of the root.
+					\param Region of the node.
+					\param Rectangle.
+					\param Threshold for the maximum difference of a region.
+					\param Vector of nodes and their regions.
+					*/
+				void cover(cv::Rect, cv::Rect, double, std::vector<std::pair<Node*, cv::Rect>>&);
+				//! Checks whether the children of the subtree can be permuted.
+				/*!
+					\param Width of region.
+					\param Height of region.
+					\param Boolean about requiring an even width on every split.
+					\param Boolean about requiring an even height on every split.
+					\param Threshold for the maximum difference of a region.
+					\return True if every node split at the threshold has the required even sides, so its children keep their sizes when swapped.
+					*/
+				bool even(int, int, bool, bool, double);
+				//! Permutes the children of the subtree.
+				/*!
+					The subtrees below the leaves at the threshold are freed, as they would not be transformed, and nodes whose children are leaves of one color become leaves, like in a rebuilt tree.
+					\param Indices of the old children taken as the northwest, northeast, southwest and southeast ones.
+					\param Threshold for the maximum difference of a region.
+					*/
+				template<class Palette>
+				void permute(const int*, double);
 				//! Set the color of the node.
 				/*!
+					The color is classified with every palette like an average color, so a file printed with a larger palette can be printed with a smaller one.
 					\param character representing the color.
 					*/
 				void setColor(char);
+#ifdef WB_STATS
+				//! Collect statistics of the subtree.
+				/*!
+					Counts the nodes and leaves and reports the depth of each leaf.
+					\param Depth of node.
+					\param Threshold for the maximum difference of a region.
+					\param Node counter.
+					\param Leaf counter.
+					*/
+				void measure(int, double, long&, long&);
+#endif
 		};
 		Node* root; /*!< Pointer to root node. */
+		double threshold; /*!< Threshold for the maximum difference of a region the tree is pruned at. */
+		double floor; /*!< Threshold the tree was built with. */
+		int palette; /*!< Number of colors of the palette. */
+		//! Calls a function with the palette of the tree.
+		/*!
+			Instantiates the templated node functions for the Bilevel, Standard and Extended palettes.
+			\param Function taking a palette object.
+			*/
+		template<class F>
+		void visit(F);
+		//! Parses the nodes above the given depth.
+		/*!
+			Subtrees on the given depth are skipped and recorded with the pointer to be set, so they can be parsed concurrently.
+			\param Pointer to be set to the node.
+			\param Position in the buffer, moved past the node.
+			\param Remaining depth.
+			\param Vector of pointers to be set and the positions of their subtrees.
+			*/
+		static void plan(Node**, const char*&, int, std::vector<std::pair<Node**, const char*>>&);
+		//! Skips a subtree.
+		/*!
+			\param Position of the subtree in the buffer.
+			\return Position after the subtree.
+			*/
+		static const char* skip(const char*);
+		//! Runs tasks on a pool of threads.
+		/*!
+			\param Number of tasks.
+			\param Number of threads.
+			\param Function running the task of the given index.
+			*/
+		static void parallel(size_t, int, std::function<void(size_t)>);
+		//! Depth of the subtrees processed concurrently.
+		/*!
+			\param Number of threads.
+			\return Depth giving at least four subtrees per thread.
+			*/
+		static int taskDepth(int);
+		//! Finds the lowest threshold satisfying a condition.
+		/*!
+			Binary searches the integer thresholds from the one the tree was built with to 255, assuming the condition holds for every threshold above one it holds for.
+			\param Condition checked on the tree pruned at the threshold.
+			\return Lowest threshold, or 256 if there is none.
+			*/
+		int search(std::function<bool()>);
+		//! Builds a node of a transformed tree.
+		/*!
+			Samples the source rectangle of the region from the nodes covering the source rectangle of its parent. Uniform regions become leaves and the others are split like the regions of an image, down to single pixels, which take the color covering most of their source rectangle. Regions of a single row or column are split too, leaving empty children, so every image can be represented.
+			\param Region of the node in the transformed image.
+			\param Function mapping a region of the transformed image to the rectangle it is taken from.
+			\param Nodes covering the source rectangle of the parent and their regions.
+			\return Pointer to the node.
+			*/
+		template<class Palette>
+		Node* remap(cv::Rect, const std::function<cv::Rect(cv::Rect)>&, const std::vector<std::pair<Node*, cv::Rect>>&);
+		//! Replaces the tree by a transformed one.
+		/*!
+			\param Width of the transformed image.
+			\param Height of the transformed image.
+			\param Function mapping a region of the transformed image to the rectangle it is taken from.
+			*/
+		void transform(int, int, std::function<cv::Rect(cv::Rect)>);
+		//! Transforms the tree by permuting the children of every node.
+		/*!
+			Rotations and mirroring map the quadrants of a region onto the quadrants of the transformed region when the sides they swap are even, which takes time linear in the number of nodes and keeps the nodes.
+			\param Indices of the old children taken as the northwest, northeast, southwest and southeast ones.
+			\param Boolean about requiring an even width on every split.
+			\param Boolean about requiring an even height on every split.
+			\param Width of the transformed image.
+			\param Height of the transformed image.
+			\return False if a split has an odd side, in which case the tree is unchanged.
+			*/
+		bool permute(const int*, bool, bool, int, int);
 		int size_x, /*!< Width of full image. */
 				size_y; /*!< Height of full image. */
 	public:
 		//! Constructor with filename.
 		/*!
-			Recursively parses quadtree starting from the root.
+			Recursively parses quadtree starting from the root. With more than one thread the nodes near the root are parsed first while skipping over the subtrees below them, then the subtrees are parsed concurrently.
 			\param Input filename.
+			\param Number of threads.
 			*/
-		QuadTree(std::string);
+		QuadTree(std::string, int = 1);
+		static double diffThreshold; /*!< Default threshold for the maximum difference of a region. */
 		//! Constructor with image.
 		/*!
 			Recursively decomposes image building the quadtree.
 			\param cv::Mat object containing the image.
 			*/
 		QuadTree(cv::Mat);
+		//! Constructor with image and threshold.
+		/*!
+			Recursively decomposes image down to the given threshold, so the tree can be pruned at any higher threshold without revisiting the pixels.
+			\param cv::Mat object containing the image.
+			\param Threshold for the maximum difference of a region.
+			*/
+		QuadTree(cv::Mat, double);
+		//! Copying is disabled, the tree owns its nodes.
+		QuadTree(const QuadTree&) = delete;
+		//! Copying is disabled, the tree owns its nodes.
+		QuadTree& operator=(const QuadTree&) = delete;
+		//! Set the threshold the tree is pruned at.
+		/*!
+			Regions whose maximum difference is not above the threshold are treated as leaves when printing, counting or building the image. Thresholds below the one the tree was built with have no further effect.
+			\param Threshold for the maximum difference of a region.
+			*/
+		void setThreshold(double);
+		//! Get the threshold the tree is pruned at.
+		/*!
+			\return Threshold for the maximum difference of a region.
+			*/
+		double getThreshold();
+		//! Prunes the tree to meet a size budget.
+		/*!
+			Sets the lowest threshold at which the predicted size is within the budget, or the highest one if there is none.
+			\param Function predicting the size from the frequency of each character.
+			\param Size budget.
+			\return True if the budget is met.
+			*/
+		bool fitSize(std::function<long(const std::map<char, long>&)>, long);
+		//! Prunes the tree to meet a quality.
+		/*!
+			Sets the highest threshold at which the peak signal-to-noise ratio to the original image is at least the given one, or the lowest one if there is none.
+			\param cv::Mat object containing the image the tree was built from.
+			\param Peak signal-to-noise ratio in dB.
+			\return True if the quality is met.
+			*/
+		bool fitQuality(cv::Mat, double);
+		//! Set the palette.
+		/*!
+			\param Number of colors of the palette (2, 5 or 8).
+			*/
+		void setPalette(int);
+		//! Get the palette.
+		/*!
+			\return Number of colors of the palette.
+			*/
+		int getPalette();
+		//! Detects the cheapest palette.
+		/*!
+			Classifies the leaves with the Extended palette, which agrees with the Standard and Bilevel palettes on the colors they contain, and returns the smallest palette containing every color covering at least a ten thousandth of the image.
+			\return Number of colors of the palette.
+			*/
+		int detectPalette();
+		//! Count the characters of the .qd file.
+		/*!
+			Walks the tree pruned at the current threshold in time linear in the number of nodes.
+			\return Frequency of each character.
+			*/
+		std::map<char, long> symbols();
+		//! Report statistics of the tree.
+		/*!
+			Counts the nodes and leaves of the tree pruned at the current threshold and their depths. Called once the tree is final, after fitting or transforming it.
+			*/
+		void measure();
+		//! Rotates the tree clockwise.
+		/*!
+			Permutes the children of every node if the sides swapped by the rotation are even on every split. Otherwise the regions are split at other rows and columns than in the original tree, so the tree of the rotated image is rebuilt from the leaves of the tree without rendering it. Either way the rendered image is exactly the original one rotated.
+			\param Number of quarter turns.
+			*/
+		void rotate(int);
+		//! Mirrors the tree.
+		/*!
+			Permutes the children or rebuilds the tree like rotate(), the rendered image is exactly the original one mirrored.
+			\param Boolean about mirroring left to right, otherwise top to bottom.
+			*/
+		void flip(bool);
+		//! Crops the tree to a quadrant.
+		/*!
+			Keeps the subtree of the quadrant and frees the rest, so the nodes of the quadrant are printed unchanged.
+			\param Path of quadrants from the root, each one of nw, ne, sw and se, optionally separated by non-letters.
+			\return False if the path is malformed or leads to an empty region, in which case the tree is unchanged.
+			*/
+		bool crop(std::string);
+		//! Downsamples the tree.
+		/*!
+			Halves the image the given number of times, rounding up. Each pixel takes the color covering most of its block of the original image, which prunes the levels below it.
+			\param Number of halvings.
+			*/
+		void downsample(int);
 		//! Print quadtree to file.
 		/*!
-			Recursively prints nodes starting from the root into a .qd file (stands for quadtree). The file containd the width and height of the image, then the data.
+			Recursively prints nodes starting from the root into a .qd file (stands for quadtree). The file containd the width and height of the image and the palette, then the data.
 			\param Output filename.
 			*/
 		void print(std::string);
 		//! Build quadtree into image.
 		/*!
-			Recursively composes image starting from the root.
+			Recursively renders image starting from the root. With more than one thread the subtrees near the root are rendered concurrently into disjoint regions of the image, the result does not depend on the number of threads.
 			\param Boolean about drawing the boundaries of the nodes.
+			\param Number of threads.
 			\return cv::Mat object containing the image.
 			*/
-		cv::Mat getImage(bool);
+		cv::Mat getImage(bool, int = 1);
 		//! Destructor.
 		/*!
 			Recursively frees nodes starting from the root.
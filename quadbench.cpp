@@ -0,0 +1,77 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include "quad.hpp"
+#include "huff.hpp"
+#include "summary.hpp"
+
+//! Benchmarks parallel parsing and rendering.
+/*!
+	Builds the quadtree of a synthetic whiteboard with random strokes, prints it and reports the time of parsing and rendering it with 1, 2, 4 and 8 threads, marking the thread counts above the number of cores, which cannot scale. Then codes it and compares the time of computing its Summary with the time of decoding, parsing and rendering it on one thread. The best of five runs is reported, every rendered image, with and without the boundaries of the nodes, is compared with the serial one and the ink area of the Summary with the rendered image.
+	*/
+int main(int argc, char** argv) {
+	int width = argc > 1 ? atoi(argv[1]) : 4096, height = argc > 2 ? atoi(argv[2]) : 3072;
+	std::string filename = "quadbench";
+
+	std::mt19937 gen(1);
+	cv::Mat board(height, width, CV_8UC3, cv::Scalar(245, 245, 245));
+	const cv::Vec3b inks[] = {cv::Vec3b(20, 20, 20), cv::Vec3b(200, 40, 30), cv::Vec3b(30, 40, 210)};
+	for (int k = 0; k < width * height / 20000; k++) {
+		double x = gen() % width, y = gen() % height, angle = gen() % 628 / 100.0;
+		cv::Vec3b ink = inks[gen() % 3];
+		for (int i = 0; i < 200; i++, x += cos(angle), y += sin(angle), angle += (int)(gen() % 21 - 10) / 100.0)
+			for (int a = 0; a < 3; a++)
+				for (int b = 0; b < 3; b++)
+					if (0 <= x + b && x + b < width && 0 <= y + a && y + a < height)
+						board.at<cv::Vec3b>(y + a, x + b) = ink;
+	}
+	QuadTree(board).print(filename);
+	cv::Mat reference = QuadTree(filename).getImage(false), grid = QuadTree(filename).getImage(true);
+
+	unsigned int cores = std::thread::hardware_concurrency();
+	printf("%dx%d, %u cores\n", width, height, cores);
+	for (int threads : {1, 2, 4, 8}) {
+		double parse = 1e9, render = 1e9;
+		for (int run = 0; run < 5; run++) {
+			auto start = std::chrono::steady_clock::now();
+			QuadTree q(filename, threads);
+			auto middle = std::chrono::steady_clock::now();
+			cv::Mat image = q.getImage(false, threads);
+			auto end = std::chrono::steady_clock::now();
+			parse = std::min(parse, std::chrono::duration<double, std::milli>(middle - start).count());
+			render = std::min(render, std::chrono::duration<double, std::milli>(end - middle).count());
+			if (cv::norm(image, reference, cv::NORM_INF) != 0 || cv::norm(q.getImage(true, threads), grid, cv::NORM_INF) != 0) {
+				printf("threads %d: mismatch\n", threads);
+				return -1;
+			}
+		}
+		printf("threads %d: parse %.2f ms, render %.2f ms%s\n", threads, parse, render, cores && (unsigned int)threads > cores ? " (more threads than cores)" : "");
+	}
+
+	huffman(filename);
+	double summary = 1e9, decode = 1e9;
+	for (int run = 0; run < 5; run++) {
+		auto start = std::chrono::steady_clock::now();
+		Summary s(filename);
+		auto middle = std::chrono::steady_clock::now();
+		dehuffman(filename);
+		cv::Mat image = QuadTree(filename).getImage(false);
+		auto end = std::chrono::steady_clock::now();
+		summary = std::min(summary, std::chrono::duration<double, std::milli>(middle - start).count());
+		decode = std::min(decode, std::chrono::duration<double, std::milli>(end - middle).count());
+		cv::Mat white;
+		cv::inRange(image, cv::Scalar(255, 255, 255), cv::Scalar(255, 255, 255), white);
+		if (s.getInk() != (long)width * height - cv::countNonZero(white)) {
+			printf("summary: mismatch\n");
+			return -1;
+		}
+	}
+	printf("summary %.2f ms, decode and render %.2f ms\n", summary, decode);
+
+	remove((filename + ".qd").c_str());
+	remove((filename + ".wb").c_str());
+	remove((filename + ".sym").c_str());
+	return 0;
+}
@@ -0,0 +1,82 @@
+#include "stats.hpp"
+
+#ifdef WB_STATS
+
+#include <algorithm>
+#include <fstream>
+#include <sys/resource.h>
+#include "json.hpp"
+
+std::vector<std::pair<std::string, Stats::Stage>> Stats::stages;
+std::vector<std::pair<std::string, long>> Stats::counters;
+std::vector<long> Stats::depths;
+std::vector<std::pair<char, long>> Stats::symbols;
+
+Stats::Timer::Timer(std::string _name) : name(_name), wall(std::chrono::steady_clock::now()), cpu(std::clock()) {}
+
+Stats::Timer::~Timer() {
+	double w = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall).count();
+	double c = 1000.0 * (std::clock() - cpu) / CLOCKS_PER_SEC;
+	Stats::time(name, w, c);
+}
+
+void Stats::time(std::string name, double wall, double cpu) {
+	auto it = std::find_if(stages.begin(), stages.end(), [&name](const std::pair<std::string, Stage>& p){return p.first == name;});
+	if (it == stages.end()) {
+		stages.push_back(std::make_pair(name, Stage{0.0, 0.0, 0}));
+		it = stages.end() - 1;
+	}
+	it->second.wall += wall;
+	it->second.cpu += cpu;
+	it->second.calls++;
+}
+
+void Stats::count(std::string name, long value) {
+	auto it = std::find_if(counters.begin(), counters.end(), [&name](const std::pair<std::string, long>& p){return p.first == name;});
+	if (it == counters.end())
+		counters.push_back(std::make_pair(name, value));
+	else
+		it->second += value;
+}
+
+void Stats::bytes(std::string name, std::string filename) {
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	if (file)
+		count(name, file.tellg());
+}
+
+void Stats::depth(int d) {
+	if (depths.size() <= (size_t)d)
+		depths.resize(d + 1, 0);
+	depths[d]++;
+}
+
+void Stats::symbol(char c, long value) {
+	auto it = std::find_if(symbols.begin(), symbols.end(), [c](const std::pair<char, long>& p){return p.first == c;});
+	if (it == symbols.end())
+		symbols.push_back(std::make_pair(c, value));
+	else
+		it->second += value;
+}
+
+void Stats::json(std::string tool, std::ostream& out) {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	out << "{\n\t\"tool\": " << quote(tool) << ",\n\t\"stages\": {";
+	for (unsigned int i = 0; i < stages.size(); i++)
+		out << (i ? "," : "") << "\n\t\t" << quote(stages[i].first) << ": {\"wall_ms\": " << stages[i].second.wall << ", \"cpu_ms\": " << stages[i].second.cpu << ", \"calls\": " << stages[i].second.calls << "}";
+	out << "\n\t},\n\t\"counters\": {";
+	for (unsigned int i = 0; i < counters.size(); i++)
+		out << (i ? "," : "") << "\n\t\t" << quote(counters[i].first) << ": " << counters[i].second;
+	out << "\n\t},\n\t\"depth_histogram\": [";
+	for (unsigned int i = 0; i < depths.size(); i++)
+		out << (i ? ", " : "") << depths[i];
+	out << "],\n\t\"symbols\": {";
+	std::sort(symbols.begin(), symbols.end());
+	for (unsigned int i = 0; i < symbols.size(); i++)
+		out << (i ? ", " : "") << quote(std::string(1, symbols[i].first)) << ": " << symbols[i].second;
+	out << "},\n\t\"peak_rss_kb\": " << usage.ru_maxrss << "\n}\n";
+}
+
+#endif
@@ -0,0 +1,96 @@
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef WB_STATS
+
+//! Class collecting pipeline statistics.
+/*!
+	The class stores stage timings, counters, the quadtree depth histogram and the symbol frequencies in static members, so every stage can report without passing state through the pipeline. It is only compiled when WB_STATS is defined (make STATS=1), otherwise the STATS_* macros expand to nothing.
+	*/
+class Stats {
+	private:
+		//! Structure for accumulated stage timings.
+		struct Stage {
+			double wall; /*!< Wall time in milliseconds. */
+			double cpu; /*!< CPU time in milliseconds. */
+			long calls; /*!< Number of timed calls. */
+		};
+		static std::vector<std::pair<std::string, Stage>> stages; /*!< Stage timings in order of first appearance. */
+		static std::vector<std::pair<std::string, long>> counters; /*!< Counters in order of first appearance. */
+		static std::vector<long> depths; /*!< Number of leaves on each depth. */
+		static std::vector<std::pair<char, long>> symbols; /*!< Symbol frequencies. */
+	public:
+		//! Class timing a scope.
+		/*!
+			The elapsed wall and CPU time between construction and destruction is added to the given stage.
+			*/
+		class Timer {
+			private:
+				std::string name; /*!< Name of the stage. */
+				std::chrono::steady_clock::time_point wall; /*!< Wall clock at construction. */
+				std::clock_t cpu; /*!< CPU clock at construction. */
+			public:
+				//! Constructor with stage name.
+				Timer(std::string);
+				//! Destructor.
+				~Timer();
+		};
+		//! Add time to a stage.
+		/*!
+			\param Name of the stage.
+			\param Wall time in milliseconds.
+			\param CPU time in milliseconds.
+			*/
+		static void time(std::string, double, double);
+		//! Add to a counter.
+		/*!
+			\param Name of the counter.
+			\param Value to add.
+			*/
+		static void count(std::string, long);
+		//! Add the size of a file to a counter.
+		/*!
+			\param Name of the counter.
+			\param Filename.
+			*/
+		static void bytes(std::string, std::string);
+		//! Count a leaf on the given depth.
+		/*!
+			\param Depth of the leaf.
+			*/
+		static void depth(int);
+		//! Add to the frequency of a symbol.
+		/*!
+			\param Symbol.
+			\param Value to add.
+			*/
+		static void symbol(char, long);
+		//! Print the statistics as a JSON object.
+		/*!
+			\param Name of the tool.
+			\param Output stream.
+			*/
+		static void json(std::string, std::ostream&);
+};
+
+#define STATS_CONCAT_(a, b) a##b
+#define STATS_CONCAT(a, b) STATS_CONCAT_(a, b)
+#define STATS_TIMER(name) Stats::Timer STATS_CONCAT(stats_timer_, __LINE__)(name)
+#define STATS_COUNT(name, value) Stats::count(name, value)
+#define STATS_BYTES(name, filename) Stats::bytes(name, filename)
+#define STATS_DEPTH(d) Stats::depth(d)
+#define STATS_SYMBOL(c, value) Stats::symbol(c, value)
+
+#else
+
+#define STATS_TIMER(name)
+#define STATS_COUNT(name, value)
+#define STATS_BYTES(name, filename)
+#define STATS_DEPTH(d)
+#define STATS_SYMBOL(c, value)
+
+#endif
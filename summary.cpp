@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <fstream>
+#include "summary.hpp"
+#include "huff.hpp"
+#include "stats.hpp"
+#include "json.hpp"
+
+Summary::Summary(std::string filename, int rows, int cols, int threads) : valid(false), width(0), height(0), palette(5), rows(rows), cols(cols) {
+	STATS_TIMER("summary");
+	std::ifstream in(filename + ".wb", std::ios::binary);
+	std::vector<unsigned char> buffer((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	in.close();
+	std::string data = decode(buffer, readSymbols(filename), width, height, palette, threads);
+	valid = !data.empty();
+	build(data);
+}
+
+Summary::Summary(const std::string& data, int width, int height, int palette, int rows, int cols) : valid(true), width(width), height(height), palette(palette), rows(rows), cols(cols) {
+	build(data);
+}
+
+void Summary::build(const std::string& data) {
+	std::fill(area, area + 8, 0);
+	std::fill(boxes, boxes + 8, Box{0, 0, 0, 0});
+	if (rows <= 0 || cols <= 0)
+		rows = cols = 0;
+	grid.assign((long)rows * cols, 0);
+	if (!valid)
+		return;
+	const char* p = data.c_str();
+	walk(p, 0, 0, width, height);
+}
+
+void Summary::walk(const char*& p, int x, int y, int w, int h) {
+	char tmp = *p;
+	if (tmp != '\0')
+		p++;
+	if (tmp == '|') {
+		int r = h / 2, c = w / 2;
+		walk(p, x, y, c, r);
+		walk(p, x + c, y, w - c, r);
+		walk(p, x, y + r, c, h - r);
+		walk(p, x + c, y + r, w - c, h - r);
+	} else
+		add(char2Color(tmp), x, y, w, h);
+}
+
+void Summary::add(Color color, int x, int y, int w, int h) {
+	if (w <= 0 || h <= 0)
+		return;
+	area[(int)color] += (long)w * h;
+	merge(boxes[(int)color], Box{x, y, w, h});
+	if (color == Color::WHITE || grid.empty())
+		return;
+	// Cell i of n spans [i * size / n, (i + 1) * size / n), so pixel p lies in cell ((p + 1) * n - 1) / size.
+	auto edge = [](int i, int size, int n) -> int {return (long)i * size / n;};
+	for (int i = ((long)(y + 1) * rows - 1) / height; i < rows && edge(i, height, rows) < y + h; i++) {
+		long dy = std::min(y + h, edge(i + 1, height, rows)) - std::max(y, edge(i, height, rows));
+		for (int j = ((long)(x + 1) * cols - 1) / width; j < cols && edge(j, width, cols) < x + w; j++)
+			grid[(long)i * cols + j] += dy * (std::min(x + w, edge(j + 1, width, cols)) - std::max(x, edge(j, width, cols)));
+	}
+}
+
+void Summary::merge(Box& box, const Box& rect) {
+	if (rect.width == 0)
+		return;
+	if (box.width == 0) {
+		box = rect;
+		return;
+	}
+	int right = std::max(box.x + box.width, rect.x + rect.width), bottom = std::max(box.y + box.height, rect.y + rect.height);
+	box.x = std::min(box.x, rect.x);
+	box.y = std::min(box.y, rect.y);
+	box.width = right - box.x;
+	box.height = bottom - box.y;
+}
+
+bool Summary::isValid() {
+	return valid;
+}
+
+int Summary::getWidth() {
+	return width;
+}
+
+int Summary::getHeight() {
+	return height;
+}
+
+int Summary::getPalette() {
+	return palette;
+}
+
+long Summary::getArea(Color color) {
+	return area[(int)color];
+}
+
+long Summary::getInk() {
+	long ink = 0;
+	for (int c = 0; c < 8; c++)
+		if (c != (int)Color::WHITE)
+			ink += area[c];
+	return ink;
+}
+
+Summary::Box Summary::getBounds(Color color) {
+	return boxes[(int)color];
+}
+
+Summary::Box Summary::getBounds() {
+	Box box = {0, 0, 0, 0};
+	for (int c = 0; c < 8; c++)
+		if (c != (int)Color::WHITE)
+			merge(box, boxes[c]);
+	return box;
+}
+
+bool Summary::isEmpty(double fraction) {
+	return getInk() <= fraction * width * height;
+}
+
+double Summary::getOccupancy(int row, int col) {
+	long h = (row + 1L) * height / rows - (long)row * height / rows, w = (col + 1L) * width / cols - (long)col * width / cols;
+	long cell = h * w;
+	return cell ? (double)grid[(long)row * cols + col] / cell : 0.0;
+}
+
+void Summary::json(std::string filename, double fraction, std::ostream& out) {
+	auto box = [](const Box& b) -> std::string {
+		return "[" + std::to_string(b.x) + ", " + std::to_string(b.y) + ", " + std::to_string(b.width) + ", " + std::to_string(b.height) + "]";
+	};
+
+	out << "{\"file\": " << quote(filename);
+	if (!valid) {
+		out << ", \"error\": \"cannot decode\"}\n";
+		return;
+	}
+	out << ", \"width\": " << width << ", \"height\": " << height << ", \"palette\": " << palette;
+	out << ", \"empty\": " << (isEmpty(fraction) ? "true" : "false") << ", \"ink\": " << getInk() << ", \"bounds\": " << box(getBounds());
+	out << ", \"colors\": {";
+	bool first = true;
+	for (int c = 0; c < 8; c++)
+		if (area[c] > 0) {
+			out << (first ? "" : ", ") << quote(std::string(1, colorChars[c])) << ": {\"area\": " << area[c] << ", \"bounds\": " << box(boxes[c]) << "}";
+			first = false;
+		}
+	out << "}";
+	if (!grid.empty()) {
+		out << ", \"grid\": [";
+		for (int i = 0; i < rows; i++) {
+			out << (i ? ", [" : "[");
+			for (int j = 0; j < cols; j++)
+				out << (j ? ", " : "") << getOccupancy(i, j);
+			out << "]";
+		}
+		out << "]";
+	}
+	out << "}\n";
+}
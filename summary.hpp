@@ -0,0 +1,130 @@
+#include <ostream>
+#include <string>
+#include <vector>
+#include "color.hpp"
+
+//! Class for statistics of a board computed in the compressed domain.
+/*!
+	The symbols of a .wb file are entropy decoded into memory like for unwb, then walked in the order they were printed, keeping the region of the current node on the way. Every leaf adds its region to the area and the bounding box of its color and to the cells of the occupancy grid it overlaps, so neither the quadtree nor the image is built. White is the background, every other color is ink.
+	*/
+class Summary {
+	public:
+		//! Structure for a rectangle of pixels.
+		struct Box {
+			int x; /*!< Left column. */
+			int y; /*!< Top row. */
+			int width; /*!< Number of columns, 0 for an empty box. */
+			int height; /*!< Number of rows, 0 for an empty box. */
+		};
+	private:
+		bool valid; /*!< Whether the file could be decoded. */
+		int width; /*!< Width of the image. */
+		int height; /*!< Height of the image. */
+		int palette; /*!< Number of colors of the palette. */
+		long area[8]; /*!< Number of pixels of each color, indexed by the Color enum. */
+		Box boxes[8]; /*!< Bounding box of each color, indexed by the Color enum. */
+		int rows; /*!< Number of rows of the occupancy grid. */
+		int cols; /*!< Number of columns of the occupancy grid. */
+		std::vector<long> grid; /*!< Number of ink pixels in each cell of the occupancy grid, row by row. */
+		//! Walks the symbols of a node.
+		/*!
+			Recursively visits the children in the order of QuadTree::Node::render(), which splits the region at half of its rows and columns.
+			\param Pointer to the next symbol, moved past the node.
+			\param Left column of the region.
+			\param Top row of the region.
+			\param Width of the region.
+			\param Height of the region.
+			*/
+		void walk(const char*&, int, int, int, int);
+		//! Adds a leaf.
+		/*!
+			\param Color of the leaf.
+			\param Left column of the region.
+			\param Top row of the region.
+			\param Width of the region.
+			\param Height of the region.
+			*/
+		void add(Color, int, int, int, int);
+		//! Merges a rectangle into a bounding box.
+		/*!
+			\param Bounding box.
+			\param Rectangle.
+			*/
+		static void merge(Box&, const Box&);
+		//! Computes the statistics of decoded symbols.
+		/*!
+			\param Symbols of the quadtree.
+			*/
+		void build(const std::string&);
+	public:
+		//! Constructor with filename.
+		/*!
+			Decodes the symbols of the .wb file into a string, using the .sym file if the file has no static model, then walks the string.
+			\param Input filename without extension.
+			\param Number of rows of the occupancy grid, 0 for no grid.
+			\param Number of columns of the occupancy grid, 0 for no grid.
+			\param Number of threads of the entropy decoder.
+			*/
+		Summary(std::string, int = 0, int = 0, int = 1);
+		//! Constructor with decoded symbols.
+		/*!
+			\param Symbols of the quadtree, as in a .qd file after the header.
+			\param Width of the image.
+			\param Height of the image.
+			\param Number of colors of the palette.
+			\param Number of rows of the occupancy grid, 0 for no grid.
+			\param Number of columns of the occupancy grid, 0 for no grid.
+			*/
+		Summary(const std::string&, int, int, int, int, int);
+		//! Whether the file could be decoded.
+		bool isValid();
+		//! Get the width of the image.
+		int getWidth();
+		//! Get the height of the image.
+		int getHeight();
+		//! Get the palette.
+		int getPalette();
+		//! Get the area of a color.
+		/*!
+			\param Color enum.
+			\return Number of pixels.
+			*/
+		long getArea(Color);
+		//! Get the area of the ink.
+		/*!
+			\return Number of pixels of every color but WHITE.
+			*/
+		long getInk();
+		//! Get the bounding box of a color.
+		/*!
+			\param Color enum.
+			\return Bounding box, with zero width if the color is not used.
+			*/
+		Box getBounds(Color);
+		//! Get the bounding box of the ink.
+		/*!
+			\return Bounding box of every color but WHITE, with zero width on an empty board.
+			*/
+		Box getBounds();
+		//! Decides whether the board is empty.
+		/*!
+			\param Fraction of the image the ink may cover on an empty board.
+			\return Whether the ink covers at most the given fraction.
+			*/
+		bool isEmpty(double = 0.0);
+		//! Get the occupancy of a cell of the grid.
+		/*!
+			\param Row of the cell.
+			\param Column of the cell.
+			\return Fraction of the cell covered by ink.
+			*/
+		double getOccupancy(int, int);
+		//! Print the statistics as a JSON object.
+		/*!
+			The object is printed on one line, so the summaries of an archive form a JSON Lines stream.
+			\param Name of the file.
+			\param Fraction of the image the ink may cover on an empty board.
+			\param Output stream.
+			*/
+		void json(std::string, double, std::ostream&);
+};
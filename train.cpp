@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include "huff.hpp"
+#include "models.hpp"
+
+//! Characters every model has to code.
+static const std::string alphabet = "|bcgkmrwy";
+
+//! Trains static entropy models.
+/*!
+	Counts the characters of each corpus of .qd files and prints the models.hpp header with the models compiled into wbtrain followed by the Huffman codes built from the counts. Corpora are separated by "--" and get the IDs from nextModel on, so the IDs of existing models, including retired ones, are never given to another code. Every character of the alphabet is counted at least once, so the models can code any file.
+	*/
+int main(int argc, char** argv) {
+
+	if (argc < 2) {
+		printf("USAGE: wbtrain FILENAME... [-- FILENAME...]\n");
+		return -1;
+	}
+
+	std::vector<std::map<char, long>> corpora(1);
+	std::vector<int> files(1, 0);
+	for (int i = 1; i < argc; i++) {
+		if (std::string(argv[i]) == "--") {
+			corpora.push_back(std::map<char, long>());
+			files.push_back(0);
+			continue;
+		}
+		std::ifstream file(argv[i]);
+		if (!file) {
+			fprintf(stderr, "wbtrain: cannot open %s\n", argv[i]);
+			return -1;
+		}
+		char tmp;
+		int x, y, palette;
+		file >> x >> y >> std::ws;
+		if (std::isdigit(file.peek()))
+			file >> palette;
+		while (file >> tmp)
+			corpora.back()[tmp]++;
+		files.back()++;
+	}
+
+	printf("// Generated by wbtrain, do not edit.\n#include \"model.hpp\"\n\n");
+	printf("//! Lowest ID not given to a model yet. IDs below it missing from models were retired.\nconstexpr int nextModel = %d;\n\n", nextModel + (int)corpora.size());
+	printf("constexpr std::array<Model, %d> models = {{\n", modelCount + (int)corpora.size());
+	for (int m = 0; m < modelCount; m++) {
+		printf("\t// kept\n\t{%d, %d, {", models[m].id, models[m].size);
+		for (int i = 0; i < models[m].size; i++)
+			printf("%s{'%c', 0x%x, %d}", i ? ", " : "", models[m].codes[i].symbol, models[m].codes[i].code, models[m].codes[i].length);
+		printf("}},\n");
+	}
+	for (unsigned int m = 0; m < corpora.size(); m++) {
+		long symbols = 0;
+		for (auto it = corpora[m].begin(); it != corpora[m].end(); it++)
+			symbols += it->second;
+		for (unsigned int i = 0; i < alphabet.size(); i++)
+			corpora[m][alphabet[i]] += corpora[m][alphabet[i]] == 0;
+		std::map<char, std::string> sym = buildCode(corpora[m]);
+		std::vector<std::pair<std::string, char>> codes;
+		for (auto it = sym.begin(); it != sym.end(); it++)
+			codes.push_back(std::make_pair(it->second, it->first));
+		std::sort(codes.begin(), codes.end(), [](const std::pair<std::string, char>& a, const std::pair<std::string, char>& b){return a.first.size() < b.first.size() || (a.first.size() == b.first.size() && a.first < b.first);});
+		printf("\t// %d files, %ld symbols\n\t{%d, %zu, {", files[m], symbols, nextModel + (int)m, codes.size());
+		for (unsigned int i = 0; i < codes.size(); i++)
+			printf("%s{'%c', 0x%lx, %zu}", i ? ", " : "", codes[i].second, std::stoul(codes[i].first, nullptr, 2), codes[i].first.size());
+		printf("}},\n");
+	}
+	printf("}};\n\nconstexpr int modelCount = models.size();\n");
+
+	return 0;
+}
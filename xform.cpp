@@ -0,0 +1,84 @@
+#include "quad.hpp"
+#include "huff.hpp"
+#include "stats.hpp"
+
+//! Transforms .wb files without decoding them into images.
+/*!
+	Parses the quadtree of the input file, applies the operations in the order given and codes the result into the output file, by default FILENAME_xf.wb. Rotations and mirroring permute the children of the nodes or rebuild the tree from its leaves and are exact, crops keep the subtree of a quadrant and downsampling halves the image the given number of times.
+	*/
+int main(int argc, char** argv) {
+
+	bool stats = false;
+	int threads = 1, streams = 1, model = -1;
+	std::vector<std::pair<std::string, std::string>> ops;
+	std::vector<std::string> args;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--stats")
+			stats = true;
+		else if (arg == "-j" && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if (arg == "-s" && i + 1 < argc)
+			streams = atoi(argv[++i]);
+		else if (arg == "-m" && i + 1 < argc)
+			model = atoi(argv[++i]);
+		else if ((arg == "-r" || arg == "-f" || arg == "-c" || arg == "-z") && i + 1 < argc)
+			ops.push_back(std::make_pair(arg, std::string(argv[++i])));
+		else
+			args.push_back(arg);
+	}
+
+	if (args.size() < 1) {
+		printf("USAGE: wbxform [-r QUARTERS] [-f h|v] [-c QUADRANTS] [-z LEVELS] [-s STREAMS] [-m MODEL] [-j THREADS] [--stats] FILENAME [OUT_FILENAME]\n");
+		return -1;
+	}
+
+#ifndef WB_STATS
+	if (stats) {
+		fprintf(stderr, "wbxform: built without statistics, rebuild with make STATS=1\n");
+		return -1;
+	}
+#endif
+
+	std::string filename = args[0];
+	filename = filename.substr(0, filename.find_last_of("."));
+	std::string out = args.size() == 2 ? args[1].substr(0, args[1].find_last_of(".")) : filename + "_xf";
+	STATS_BYTES("bytes_in", filename + ".wb");
+	if (!dehuffman(filename, threads))
+		return -1;
+	QuadTree q(filename, threads);
+
+	for (unsigned int i = 0; i < ops.size(); i++) {
+		const std::string& value = ops[i].second;
+		bool valid = true;
+		if (ops[i].first == "-r")
+			q.rotate(atoi(value.c_str()));
+		else if (ops[i].first == "-f") {
+			valid = value == "h" || value == "v";
+			if (valid)
+				q.flip(value == "h");
+		}
+		else if (ops[i].first == "-c")
+			valid = q.crop(value);
+		else if (ops[i].first == "-z")
+			q.downsample(atoi(value.c_str()));
+		if (!valid) {
+			fprintf(stderr, "wbxform: invalid %s %s\n", ops[i].first.c_str(), value.c_str());
+			return -1;
+		}
+	}
+
+	q.measure();
+	q.print(out);
+	if (!huffman(out, streams, model))
+		return -1;
+	STATS_BYTES("bytes_out", out + ".wb");
+
+#ifdef WB_STATS
+	if (stats)
+		Stats::json("wbxform", std::cout);
+#endif
+
+	return 0;
+}
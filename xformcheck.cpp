@@ -0,0 +1,142 @@
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include "quad.hpp"
+
+//! Majority downsampling of a rendered image.
+/*!
+	\param Rendered image.
+	\param Number of halvings.
+	\return Image whose pixels take the color covering most of their block, WHITE on ties with it.
+	*/
+static cv::Mat downsample(const cv::Mat& image, int levels) {
+	int size = 1 << levels;
+	cv::Mat result((image.rows + size - 1) / size, (image.cols + size - 1) / size, CV_8UC3);
+	for (int y = 0; y < result.rows; y++)
+		for (int x = 0; x < result.cols; x++) {
+			long area[8] = {0};
+			for (int i = y * size; i < std::min(image.rows, (y + 1) * size); i++)
+				for (int j = x * size; j < std::min(image.cols, (x + 1) * size); j++) {
+					const cv::Vec3b& p = image.at<cv::Vec3b>(i, j);
+					for (int c = 0; c < 8; c++)
+						if (p[0] == colorValues[c][0] && p[1] == colorValues[c][1] && p[2] == colorValues[c][2])
+							area[c]++;
+				}
+			int best = (int)Color::WHITE;
+			for (int c = 0; c < 8; c++)
+				if (area[c] > area[best])
+					best = c;
+			result.at<cv::Vec3b>(y, x) = cv::Vec3b(colorValues[best][0], colorValues[best][1], colorValues[best][2]);
+		}
+	return result;
+}
+
+//! Region of a quadrant path.
+/*!
+	\param Path of quadrants as taken by QuadTree::crop().
+	\param Width of the image.
+	\param Height of the image.
+	\return Region of the quadrant in the image.
+	*/
+static cv::Rect quadrant(std::string path, int w, int h) {
+	int x = 0, y = 0;
+	for (unsigned int i = 0; i + 1 < path.size(); i += 3) {
+		int r = h / 2, c = w / 2;
+		if (path[i] == 's') {
+			y += r;
+			h -= r;
+		} else
+			h = r;
+		if (path[i + 1] == 'e') {
+			x += c;
+			w -= c;
+		} else
+			w = c;
+	}
+	return cv::Rect(x, y, w, h);
+}
+
+//! Checks that the transforms of wbxform are exact.
+/*!
+	Builds the quadtrees of synthetic whiteboards with even and odd sides, both pruned from a lower threshold and parsed from a .qd file, applies every rotation, mirroring, a few crops and downsamplings and compares the rendered result with the same operation applied to the rendered original. Exits with -1 on the first mismatch.
+	*/
+int main(int argc, char** argv) {
+	std::string filename = "xformcheck";
+	const std::pair<int, int> sizes[] = {{512, 512}, {512, 384}, {641, 479}, {300, 1}};
+	const std::string paths[] = {"nw", "se", "ne.sw", "sw.ne.se"};
+
+	for (const std::pair<int, int>& size : sizes) {
+		int width = size.first, height = size.second;
+		std::mt19937 gen(width + height);
+		cv::Mat board(height, width, CV_8UC3, cv::Scalar(245, 245, 245));
+		const cv::Vec3b inks[] = {cv::Vec3b(20, 20, 20), cv::Vec3b(200, 40, 30), cv::Vec3b(30, 40, 210), cv::Vec3b(20, 230, 230)};
+		for (int k = 0; k < width * height / 4000 + 1; k++) {
+			double x = gen() % width, y = gen() % height, angle = gen() % 628 / 100.0;
+			cv::Vec3b ink = inks[gen() % 4];
+			for (int i = 0; i < 100; i++, x += cos(angle), y += sin(angle), angle += (int)(gen() % 21 - 10) / 100.0)
+				for (int a = 0; a < 3; a++)
+					for (int b = 0; b < 3; b++)
+						if (0 <= x + b && x + b < width && 0 <= y + a && y + a < height)
+							board.at<cv::Vec3b>(y + a, x + b) = ink;
+		}
+		{
+			QuadTree q(board);
+			q.setPalette(q.detectPalette());
+			q.print(filename);
+		}
+
+		for (bool parsed : {false, true}) {
+			auto tree = [&]() {
+				std::unique_ptr<QuadTree> q(parsed ? new QuadTree(filename) : new QuadTree(board, 16.0));
+				if (!parsed) {
+					q->setThreshold(QuadTree::diffThreshold);
+					q->setPalette(q->detectPalette());
+				}
+				return q;
+			};
+			cv::Mat original = tree()->getImage(false);
+			auto check = [&](std::string name, const cv::Mat& image, const cv::Mat& expected) {
+				bool ok = image.rows == expected.rows && image.cols == expected.cols && cv::norm(image, expected, cv::NORM_INF) == 0;
+				printf("%dx%d %s %s: %s\n", width, height, parsed ? "parsed" : "built", name.c_str(), ok ? "exact" : "mismatch");
+				return ok;
+			};
+
+			for (int quarters = 1; quarters < 4; quarters++) {
+				std::unique_ptr<QuadTree> q = tree();
+				q->rotate(quarters);
+				cv::Mat expected;
+				cv::rotate(original, expected, quarters == 1 ? cv::ROTATE_90_CLOCKWISE : quarters == 2 ? cv::ROTATE_180 : cv::ROTATE_90_COUNTERCLOCKWISE);
+				if (!check("rotate " + std::to_string(quarters), q->getImage(false), expected))
+					return -1;
+			}
+			for (bool horizontal : {true, false}) {
+				std::unique_ptr<QuadTree> q = tree();
+				q->flip(horizontal);
+				cv::Mat expected;
+				cv::flip(original, expected, horizontal ? 1 : 0);
+				if (!check(horizontal ? "flip h" : "flip v", q->getImage(false), expected))
+					return -1;
+			}
+			for (const std::string& path : paths) {
+				std::unique_ptr<QuadTree> q = tree();
+				cv::Rect rect = quadrant(path, width, height);
+				if (q->crop(path) != (rect.area() > 0)) {
+					printf("%dx%d %s crop %s: wrong result\n", width, height, parsed ? "parsed" : "built", path.c_str());
+					return -1;
+				}
+				if (rect.area() > 0 && !check("crop " + path, q->getImage(false), original(rect)))
+					return -1;
+			}
+			for (int levels : {1, 3}) {
+				std::unique_ptr<QuadTree> q = tree();
+				q->downsample(levels);
+				if (!check("downsample " + std::to_string(levels), q->getImage(false), downsample(original, levels)))
+					return -1;
+			}
+		}
+	}
+
+	remove((filename + ".qd").c_str());
+	return 0;
+}